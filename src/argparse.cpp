@@ -1,11 +1,23 @@
 #include "argparse.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <getopt.h>
+#include <sstream>
 #include <unistd.h>
 
 namespace {
 constexpr const struct option LONG_FLAGS[] = {
     {"ignore", required_argument, nullptr, 'i'},
     {"ignore-category", required_argument, nullptr, 'c'},
+    {"jobs", required_argument, nullptr, 'j'},
+    {"search-stats", no_argument, nullptr, 's'},
+    {"batch", no_argument, nullptr, 'b'},
+    {"manifest", required_argument, nullptr, 'm'},
+    {"daemon", required_argument, nullptr, 'D'},
+    {"client", required_argument, nullptr, 'C'},
+    {"lsp", no_argument, nullptr, 'L'},
+    {"cache-dir", required_argument, nullptr, 'K'},
     {"help", no_argument, nullptr, 'h'},
     {0, 0, 0, 0},
 };
@@ -34,13 +46,78 @@ bool add_ignored_category(LZN::Arguments &results, const char *arg) {
   }
   return false;
 }
+
+bool set_jobs(LZN::Arguments &results, const char *arg) {
+  try {
+    std::size_t pos;
+    const int jobs = std::stoi(arg, &pos);
+    if (arg[pos] != '\0' || jobs <= 0)
+      return false;
+    results.jobs = jobs;
+    return true;
+  } catch (const std::invalid_argument &) {
+  } catch (const std::out_of_range &) {}
+  return false;
+}
+
+namespace fs = std::filesystem;
+
+// Add every `.mzn` file in `dir` and its subdirectories, sorted to always be in the same order.
+bool add_directory(std::vector<LZN::LintTarget> &targets, const fs::path &dir) {
+  std::vector<std::string> models;
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+    if (it->is_regular_file(ec) && it->path().extension() == ".mzn")
+      models.push_back(it->path().string());
+  }
+  if (ec)
+    return false;
+  std::sort(models.begin(), models.end());
+  for (auto &model : models) {
+    targets.push_back(LZN::LintTarget{std::move(model), {}, std::nullopt});
+  }
+  return true;
+}
+
+// Add the models of a manifest: one model per line followed by its data files, separated by
+// whitespace. Relative paths are relative to the directory of the manifest. Empty lines and lines
+// starting with `#` are skipped.
+bool add_manifest(std::vector<LZN::LintTarget> &targets, const std::string &manifest) {
+  std::ifstream f(manifest);
+  if (!f)
+    return false;
+  const fs::path base = fs::path(manifest).parent_path();
+  auto resolve = [&base](const std::string &file) {
+    const fs::path p(file);
+    return p.is_absolute() ? p.string() : (base / p).string();
+  };
+
+  std::string line;
+  while (std::getline(f, line)) {
+    std::istringstream words(line);
+    std::string model;
+    if (!(words >> model) || model.front() == '#')
+      continue;
+    LZN::LintTarget target{resolve(model), {}, std::nullopt};
+    for (std::string data; words >> data;) {
+      target.datafiles.push_back(resolve(data));
+    }
+    targets.push_back(std::move(target));
+  }
+  return true;
+}
 } // namespace
 
 namespace LZN {
 void print_help_msg() {
   std::cout << //
       "Usage:\n"
-      "  lzn [--help] [--ignore idOrName] [--ignore-category name] [--] modelfile [datafiles...]\n"
+      "  lzn [--help] [--ignore idOrName] [--ignore-category name] [--jobs n] [--search-stats]\n"
+      "      [--manifest file] [--] modelfile [datafiles...]\n"
+      "  lzn [flags...] --batch [--manifest file] [--] [models or directories...]\n"
+      "  lzn [flags...] --daemon socket\n"
+      "  lzn [flags...] --client socket [--batch] [--] [models or modelfile datafiles...]\n"
+      "  lzn [flags...] --lsp\n"
       "\n"
       "Flags:\n"
       "  --help/-h                  Print this help message.\n"
@@ -58,6 +135,21 @@ void print_help_msg() {
     std::cout << CATEGORY_NAMES[i];
   }
   std::cout << "." << std::endl;
+  std::cout << //
+      "  --jobs/-j n                Lint with n threads, default is 1.\n"
+      "  --search-stats             Print how many model searches were cached to stderr.\n"
+      "  --batch/-b                 Lint every given model, and every .mzn file in the given\n"
+      "                             directories, in one process. Data files can't be given.\n"
+      "  --manifest/-m file         Also lint the models listed in file, one per line followed by\n"
+      "                             its data files. Paths are relative to the manifest.\n"
+      "  --daemon socket            Keep running and lint what clients ask for on the Unix\n"
+      "                             domain socket, one request at a time.\n"
+      "  --client socket            Lint with the daemon on socket instead of in this process,\n"
+      "                             with the same flags and arguments.\n"
+      "  --lsp                      Be a language server on stdin and stdout, linting open\n"
+      "                             documents as they are edited.\n"
+      "  --cache-dir dir            Reuse the results of models that haven't changed since an\n"
+      "                             earlier run with the same dir, rules and version.\n";
 }
 
 ArgRes parse_args(int argc, char *argv[]) {
@@ -66,7 +158,7 @@ ArgRes parse_args(int argc, char *argv[]) {
 
   Arguments results;
   while (true) {
-    int opt = getopt_long(argc, argv, "+:i:c:h", LONG_FLAGS, nullptr);
+    int opt = getopt_long(argc, argv, "+:i:c:j:bm:D:C:K:h", LONG_FLAGS, nullptr);
     if (opt == -1)
       break;
 
@@ -77,6 +169,18 @@ ArgRes parse_args(int argc, char *argv[]) {
         return ArgError{"invalid category name"};
       };
       break;
+    case 'j':
+      if (!set_jobs(results, optarg)) {
+        return ArgError{"the number of jobs must be a positive integer"};
+      }
+      break;
+    case 's': results.print_search_stats = true; break;
+    case 'b': results.batch = true; break;
+    case 'm': results.manifest = optarg; break;
+    case 'D': results.daemon_socket = optarg; break;
+    case 'C': results.client_socket = optarg; break;
+    case 'L': results.lsp = true; break;
+    case 'K': results.cache_dir = optarg; break;
     case 'h': return PrintHelp{};
     case ':': {
       std::string msg = "missing argument for flag: ";
@@ -91,7 +195,20 @@ ArgRes parse_args(int argc, char *argv[]) {
     }
   }
 
+  // the models come with each request, or are opened by the editor
+  if (!results.daemon_socket.empty() || results.lsp)
+    return results;
+
+  if (results.batch) {
+    results.batch_paths.assign(argv + optind, argv + argc);
+    if (results.batch_paths.empty() && results.manifest.empty())
+      return ArgError{"no models given to lint in batch mode"};
+    return results;
+  }
+
   if (optind >= argc) {
+    if (!results.manifest.empty())
+      return results;
     return ArgError{"missing required positional argument, namely the model file"};
   }
   // TODO: normalize filename?
@@ -106,6 +223,26 @@ ArgRes parse_args(int argc, char *argv[]) {
   return results;
 }
 
+std::variant<std::vector<LintTarget>, ArgError> lint_targets(const Arguments &args) {
+  std::vector<LintTarget> targets;
+  if (!args.model_filename.empty())
+    targets.push_back(LintTarget{args.model_filename, args.datafiles, std::nullopt});
+
+  for (const auto &path : args.batch_paths) {
+    std::error_code ec;
+    if (!fs::is_directory(path, ec)) {
+      targets.push_back(LintTarget{path, {}, std::nullopt});
+    } else if (!add_directory(targets, path)) {
+      return ArgError{"couldn't read directory: " + path};
+    }
+  }
+
+  if (!args.manifest.empty() && !add_manifest(targets, args.manifest))
+    return ArgError{"couldn't read manifest: " + args.manifest};
+
+  return targets;
+}
+
 #define VEC_CONTAINS(vec, val) (std::find(vec.cbegin(), vec.cend(), val) != vec.cend())
 bool is_rule_ignored(const Arguments &args, const LintRule &rule) {
   if (VEC_CONTAINS(args.ignored_rules, rule.id)) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <linter/rules.hpp>
+#include <linter/target.hpp>
 #include <string>
 #include <variant>
 #include <vector>
@@ -16,11 +17,20 @@ public:
 // A valid parse of the cmdline arguments
 class Arguments {
 public:
-  std::string model_filename; // required
+  std::string model_filename; // required, unless in batch mode or given a manifest
   std::vector<std::string> datafiles;
+  bool batch = false;                  // lint every model in `batch_paths`
+  std::vector<std::string> batch_paths; // models and directories of models, without data files
+  std::string manifest;                 // a file listing models and their data files, or empty
+  std::string daemon_socket;            // serve lint requests on this socket, or empty
+  std::string client_socket;            // lint with the daemon on this socket, or empty
+  bool lsp = false;                     // be a language server on stdin and stdout
+  std::string cache_dir;                // where to cache results between runs, or empty
   std::vector<lintId> ignored_rules;
   std::vector<std::string> ignored_rule_names;
   std::vector<Category> ignored_categories;
+  unsigned int jobs = 1; // the number of threads to lint with
+  bool print_search_stats = false;
 };
 
 // The printing of a long help message was requested
@@ -36,6 +46,11 @@ using ArgRes = std::variant<Arguments, PrintHelp, ArgError>;
 // to print a help message.
 ArgRes parse_args(int argc, char *argv[]);
 
+// The models to lint, from the model file, the batch paths and the manifest of `args`, in that
+// order, or an error if a path or the manifest can't be read. Directories are searched recursively
+// for `.mzn` files.
+std::variant<std::vector<LintTarget>, ArgError> lint_targets(const Arguments &args);
+
 // Returns true if `rule` should be ignored, as given from `args`.
 bool is_rule_ignored(const Arguments &args, const LintRule &rule);
 } // namespace LZN
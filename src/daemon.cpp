@@ -0,0 +1,319 @@
+#include "daemon.hpp"
+#include "lint.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <linter/result_io.hpp>
+#include <linter/stdoutprinter.hpp>
+#include <optional>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// A request is one message with the working directory of the client, the rule selection and the
+// models to lint. The daemon answers with one message per model, as soon as it is linted, or with
+// an error if the request can't be served. Every message is its size as 4 bytes followed by its
+// contents, written with a `BinaryWriter`.
+namespace {
+using namespace LZN;
+
+enum Reply : std::uint8_t { MODEL, ERROR };
+
+// Messages larger than this are taken to be garbage.
+constexpr std::uint32_t MAX_MESSAGE = 1u << 30;
+
+// A file descriptor that is closed when it goes out of scope.
+class FileDescriptor {
+  int fd;
+
+public:
+  explicit FileDescriptor(int fd) : fd(fd) {}
+  FileDescriptor(const FileDescriptor &) = delete;
+  FileDescriptor &operator=(const FileDescriptor &) = delete;
+  ~FileDescriptor() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+  int get() const noexcept { return fd; }
+};
+
+bool write_all(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool read_all(int fd, char *data, std::size_t size) {
+  while (size > 0) {
+    const ssize_t n = ::recv(fd, data, size, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool send_message(int fd, const std::string &msg) {
+  std::string header;
+  BinaryWriter(header).u32(static_cast<std::uint32_t>(msg.size()));
+  return write_all(fd, header.data(), header.size()) && write_all(fd, msg.data(), msg.size());
+}
+
+std::optional<std::string> receive_message(int fd) {
+  std::string header(4, '\0');
+  if (!read_all(fd, header.data(), header.size()))
+    return std::nullopt;
+  BinaryReader r(header);
+  const std::uint32_t size = r.u32();
+  if (size > MAX_MESSAGE)
+    return std::nullopt;
+  std::string msg(size, '\0');
+  if (!read_all(fd, msg.data(), msg.size()))
+    return std::nullopt;
+  return msg;
+}
+
+// The address of `socket_path`, nullopt if the path is too long.
+std::optional<sockaddr_un> socket_address(const std::string &socket_path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path))
+    return std::nullopt;
+  std::strcpy(addr.sun_path, socket_path.c_str());
+  return addr;
+}
+
+struct Request {
+  std::string cwd;
+  Arguments args; // only the rule selection, the number of jobs and the cache directory
+  std::vector<LintTarget> targets;
+};
+
+std::string encode_request(const Request &req) {
+  std::string msg;
+  BinaryWriter w(msg);
+  w.str(req.cwd);
+  w.u32(req.args.jobs);
+  w.u32(static_cast<std::uint32_t>(req.args.ignored_rules.size()));
+  for (auto id : req.args.ignored_rules) {
+    w.u32(id);
+  }
+  w.u32(static_cast<std::uint32_t>(req.args.ignored_rule_names.size()));
+  for (const auto &name : req.args.ignored_rule_names) {
+    w.str(name);
+  }
+  w.u32(static_cast<std::uint32_t>(req.args.ignored_categories.size()));
+  for (auto cat : req.args.ignored_categories) {
+    w.u8(static_cast<std::uint8_t>(cat));
+  }
+  w.str(req.args.cache_dir);
+  w.u32(static_cast<std::uint32_t>(req.targets.size()));
+  for (const auto &target : req.targets) {
+    w.str(target.model);
+    w.u32(static_cast<std::uint32_t>(target.datafiles.size()));
+    for (const auto &data : target.datafiles) {
+      w.str(data);
+    }
+  }
+  return msg;
+}
+
+std::optional<Request> decode_request(const std::string &msg) {
+  BinaryReader r(msg);
+  Request req;
+  req.cwd = r.str();
+  req.args.jobs = std::max<std::uint32_t>(r.u32(), 1);
+  for (std::uint32_t i = r.u32(); i > 0 && r.ok(); --i) {
+    req.args.ignored_rules.push_back(r.u32());
+  }
+  for (std::uint32_t i = r.u32(); i > 0 && r.ok(); --i) {
+    req.args.ignored_rule_names.push_back(r.str());
+  }
+  for (std::uint32_t i = r.u32(); i > 0 && r.ok(); --i) {
+    const std::uint8_t cat = r.u8();
+    if (cat >= CATEGORY_NAMES.size())
+      return std::nullopt;
+    req.args.ignored_categories.push_back(static_cast<Category>(cat));
+  }
+  req.args.cache_dir = r.str();
+  for (std::uint32_t i = r.u32(); i > 0 && r.ok(); --i) {
+    LintTarget &target = req.targets.emplace_back();
+    target.model = r.str();
+    for (std::uint32_t j = r.u32(); j > 0 && r.ok(); --j) {
+      target.datafiles.push_back(r.str());
+    }
+  }
+  if (!r.ok() || !r.at_end())
+    return std::nullopt;
+  return req;
+}
+
+std::string error_reply(const std::string &what) {
+  std::string msg;
+  BinaryWriter w(msg);
+  w.u8(ERROR);
+  w.str(what);
+  return msg;
+}
+
+// Serve the request on `fd`, the connection is given up on as soon as something fails. Exceptions
+// from linting are passed on to the caller.
+void serve(int fd, const std::vector<std::string> &include_paths) {
+  const auto msg = receive_message(fd);
+  if (!msg)
+    return;
+  const auto req = decode_request(*msg);
+  if (!req) {
+    send_message(fd, error_reply("malformed request"));
+    return;
+  }
+  // the models are given relative to the client, the daemon serves one request at a time
+  if (::chdir(req->cwd.c_str()) != 0) {
+    send_message(fd, error_reply("couldn't enter directory: " + req->cwd));
+    return;
+  }
+
+  const LintSession session(req->args, include_paths);
+  std::optional<ResultCache> cache;
+  if (!req->args.cache_dir.empty())
+    cache.emplace(req->args.cache_dir, session.include_paths, session.rules);
+  for (const auto &target : req->targets) {
+    std::ostringstream errs;
+    const ModelLint lint = lint_cached(session, target, errs, cache ? &*cache : nullptr);
+
+    std::string reply;
+    BinaryWriter w(reply);
+    w.u8(MODEL);
+    w.u8(lint.ok);
+    w.str(errs.str());
+    w.u64(lint.search_stats.hits);
+    w.u64(lint.search_stats.misses);
+    write_results(w, lint.results);
+    if (!send_message(fd, reply))
+      return;
+  }
+}
+} // namespace
+
+namespace LZN {
+
+int run_daemon(const std::string &socket_path) {
+  const auto addr = socket_address(socket_path);
+  if (!addr) {
+    std::cerr << "socket path is too long: " << socket_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::vector<std::string> include_paths = LintSession::stdlib_include_paths();
+
+  const FileDescriptor listener(::socket(AF_UNIX, SOCK_STREAM, 0));
+  // a socket left behind by an earlier daemon would make `bind` fail
+  ::unlink(socket_path.c_str());
+  if (listener.get() < 0 ||
+      ::bind(listener.get(), reinterpret_cast<const sockaddr *>(&*addr), sizeof(*addr)) != 0 ||
+      ::listen(listener.get(), SOMAXCONN) != 0) {
+    std::cerr << "couldn't listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  while (true) {
+    const FileDescriptor conn(::accept(listener.get(), nullptr, nullptr));
+    if (conn.get() < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      std::cerr << "couldn't accept a client: " << std::strerror(errno) << std::endl;
+      return EXIT_FAILURE;
+    }
+    // a model that makes the linter throw only fails its own request
+    try {
+      serve(conn.get(), include_paths);
+    } catch (const std::exception &e) {
+      send_message(conn.get(), error_reply(e.what()));
+    } catch (...) {
+      send_message(conn.get(), error_reply("unknown error"));
+    }
+  }
+}
+
+int run_client(const std::string &socket_path, const Arguments &args,
+               const std::vector<LintTarget> &targets) {
+  const auto addr = socket_address(socket_path);
+  if (!addr) {
+    std::cerr << "socket path is too long: " << socket_path << std::endl;
+    return EXIT_FAILURE;
+  }
+  const FileDescriptor conn(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (conn.get() < 0 ||
+      ::connect(conn.get(), reinterpret_cast<const sockaddr *>(&*addr), sizeof(*addr)) != 0) {
+    std::cerr << "couldn't connect to the daemon on " << socket_path << ": "
+              << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  char cwd[4096];
+  if (::getcwd(cwd, sizeof(cwd)) == nullptr) {
+    std::cerr << "couldn't get the working directory: " << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!send_message(conn.get(), encode_request(Request{cwd, args, targets}))) {
+    std::cerr << "couldn't send the request to the daemon" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const bool several = targets.size() > 1;
+  bool all_ok = true;
+  LintEnv::SearchStats stats;
+  for (const auto &target : targets) {
+    const auto msg = receive_message(conn.get());
+    if (!msg) {
+      std::cerr << "lost the connection to the daemon" << std::endl;
+      return EXIT_FAILURE;
+    }
+    BinaryReader r(*msg);
+    const std::uint8_t reply = r.u8();
+    if (reply == ERROR) {
+      std::cerr << "the daemon failed: " << r.str() << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (reply != MODEL) {
+      std::cerr << "unexpected reply from the daemon" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    const bool ok = r.u8() != 0;
+    const std::string errors = r.str();
+    stats.hits += r.u64();
+    stats.misses += r.u64();
+    const auto results = read_results(r);
+    if (!results) {
+      std::cerr << "malformed results from the daemon" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (several)
+      stdout_print_heading(target.model);
+    std::cerr << errors;
+    stdout_print(*results);
+    all_ok = all_ok && ok;
+  }
+
+  if (args.print_search_stats) {
+    std::cerr << "model searches: " << stats.hits << " cached, " << stats.misses << " performed"
+              << std::endl;
+  }
+  return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+} // namespace LZN
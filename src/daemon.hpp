@@ -0,0 +1,20 @@
+#pragma once
+
+#include "argparse.hpp"
+#include <string>
+#include <vector>
+
+namespace LZN {
+
+// Serve lint requests from `run_client` on the Unix domain socket `socket_path` until killed. The
+// standard library is looked up once, and requests are served one at a time since only one model
+// can be linted at a time. Returns the exit status if the socket can't be served.
+int run_daemon(const std::string &socket_path);
+
+// Lint `targets` with the rules selected by `args` in the daemon on `socket_path`, and print the
+// results of each model as they arrive, like linting in this process would. Returns the exit
+// status.
+int run_client(const std::string &socket_path, const Arguments &args,
+               const std::vector<LintTarget> &targets);
+
+} // namespace LZN
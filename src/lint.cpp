@@ -0,0 +1,124 @@
+#include "lint.hpp"
+#include <linter/file_utils.hpp>
+#include <linter/registry.hpp>
+#include <minizinc/file_utils.hh>
+#include <minizinc/parser.hh>
+#include <minizinc/typecheck.hh>
+#include <sstream>
+#include <unordered_set>
+
+namespace {
+// Add the files of every model `m` includes, at any depth, that isn't in `include_paths`.
+void add_included_files(const MiniZinc::Model *m, const std::vector<std::string> &include_paths,
+                        std::unordered_set<const MiniZinc::Model *> &seen,
+                        std::vector<std::string> &files) {
+  for (auto it = m->begin(); it != m->end(); ++it) {
+    auto inc = (*it)->dynamicCast<MiniZinc::IncludeI>();
+    if (inc == nullptr || inc->m() == nullptr || !seen.insert(inc->m()).second)
+      continue;
+    const MiniZinc::ASTString path = inc->m()->filepath();
+    if (path.size() == 0 || LZN::path_included_from(include_paths, path))
+      continue;
+    files.emplace_back(path.c_str());
+    add_included_files(inc->m(), include_paths, seen, files);
+  }
+}
+} // namespace
+
+namespace LZN {
+
+LintSession::LintSession(const Arguments &args, std::vector<std::string> include_paths)
+    : include_paths(std::move(include_paths)), jobs(args.jobs) {
+  for (auto rule : Registry::iter()) {
+    if (!is_rule_ignored(args, *rule))
+      rules.push_back(rule);
+  }
+}
+
+std::vector<std::string> LintSession::stdlib_include_paths() {
+  return {MiniZinc::FileUtils::file_path(MiniZinc::FileUtils::share_directory()) + "/std/"};
+}
+
+ModelLint lint_model(const LintSession &session, const LintTarget &target, std::ostream &errs,
+                     ItemResults *items) {
+  ModelLint lint;
+
+  // parse and typecheck
+  MiniZinc::GCLock lock;
+  std::vector<std::string> filenames;
+  std::string text, text_name;
+  if (target.contents) {
+    text = *target.contents;
+    text_name = target.model;
+  } else {
+    filenames.push_back(target.model);
+  }
+  std::stringstream errstream;
+  MiniZinc::Env env;
+  MiniZinc::Model *m =
+      MiniZinc::parse(env, filenames, target.datafiles, text, text_name, session.include_paths,
+                      false, false, false, false, errstream);
+
+  char empty_check;
+  if (errstream.readsome(&empty_check, 1) == 1) {
+    errs << "parse errors:" << std::endl;
+    errs << empty_check;
+    errs << errstream.rdbuf();
+  }
+  if (m == nullptr)
+    return lint;
+
+  std::vector<MiniZinc::TypeError> typeErrors;
+  try {
+    MiniZinc::typecheck(env, m, typeErrors, true, false);
+  } catch (MiniZinc::TypeError &te) {
+    typeErrors.push_back(te);
+  }
+  if (!typeErrors.empty()) {
+    errs << "type errors:" << std::endl;
+    for (auto &te : typeErrors) {
+      errs << te.loc() << ":" << std::endl;
+      errs << te.what() << ": " << te.msg() << std::endl;
+    }
+    return lint;
+  }
+
+  std::unordered_set<const MiniZinc::Model *> seen{m};
+  add_included_files(m, session.include_paths, seen, lint.included_files);
+
+  // run linter
+  LintEnv lenv(m, env, session.include_paths, session.jobs);
+  lenv.prepass();
+  if (items != nullptr)
+    lint.results = run_incrementally(lenv, session.rules, *items, lint.search_stats);
+  else
+    lint.results = lenv.lint(session.rules);
+
+  lint.ok = true;
+  lint.search_stats.hits += lenv.search_stats().hits;
+  lint.search_stats.misses += lenv.search_stats().misses;
+  return lint;
+}
+
+ModelLint lint_cached(const LintSession &session, const LintTarget &target, std::ostream &errs,
+                      const ResultCache *cache) {
+  if (cache == nullptr)
+    return lint_model(session, target, errs);
+  if (auto cached = cache->lookup(target)) {
+    ModelLint lint;
+    lint.ok = true;
+    lint.results = std::move(*cached);
+    return lint;
+  }
+
+  // a changed model gets the results of its unchanged items from the last time it was linted
+  ItemResults items = cache->lookup_items(target);
+  ModelLint lint = lint_model(session, target, errs, &items);
+  if (lint.ok) {
+    cache->store(target, lint.results, lint.included_files);
+    cache->store_items(target, items);
+  }
+  return lint;
+}
+
+} // namespace LZN
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "argparse.hpp"
+#include <linter/cache.hpp>
+#include <linter/incremental.hpp>
+#include <linter/rules.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace LZN {
+
+// What is the same for every model linted by one process: where the standard library is and which
+// rules to run. It is set up once, no matter how many models are linted.
+struct LintSession {
+  std::vector<std::string> include_paths;
+  std::vector<const LintRule *> rules;
+  unsigned int jobs = 1;
+
+  // Run the rules `args` doesn't ignore with the standard library in `include_paths`.
+  LintSession(const Arguments &args, std::vector<std::string> include_paths);
+  // Same as above with the standard library in the share directory.
+  explicit LintSession(const Arguments &args) : LintSession(args, stdlib_include_paths()) {}
+
+  // The include path of the standard library in MiniZinc's share directory.
+  static std::vector<std::string> stdlib_include_paths();
+};
+
+// The outcome of linting one model.
+struct ModelLint {
+  bool ok = false; // false if the model couldn't be parsed or typechecked
+  std::vector<LintResult> results;
+  LintEnv::SearchStats search_stats;
+  std::vector<std::string> included_files; // user defined files the model includes, at any depth
+};
+
+// Parse, typecheck and lint `target`, from its contents if it has any, writing parse and type
+// errors to `errs`. The MiniZinc parser and garbage collector aren't thread safe, so only one model
+// can be linted at a time. Everything parsed is unlocked for the garbage collector when this
+// returns.
+//
+// If `items` is given it holds the results of the rules with `RuleScope::ITEM` from an earlier run.
+// Those rules are then only run on the items that have no results for all of them, and `items` is
+// replaced by the results of every item in this model, to be given to the next run.
+ModelLint lint_model(const LintSession &session, const LintTarget &target, std::ostream &errs,
+                     ItemResults *items = nullptr);
+
+// Lint `target` like `lint_model`, with the results stored in `cache` if it has any, or else
+// storing them there unless it failed to parse or typecheck. Without a cache it is the same as
+// `lint_model`.
+ModelLint lint_cached(const LintSession &session, const LintTarget &target, std::ostream &errs,
+                      const ResultCache *cache);
+
+} // namespace LZN
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <linter/bounds.hpp>
+#include <optional>
+
+namespace {
+using namespace LZN;
+using BT = MiniZinc::BinOpType;
+
+constexpr long long MAX = std::numeric_limits<long long>::max();
+constexpr long long MIN = std::numeric_limits<long long>::min();
+
+std::optional<long long> checked_add(long long a, long long b) {
+  if ((b > 0 && a > MAX - b) || (b < 0 && a < MIN - b))
+    return std::nullopt;
+  return a + b;
+}
+
+std::optional<long long> checked_neg(long long a) {
+  if (a == MIN)
+    return std::nullopt;
+  return -a;
+}
+
+std::optional<long long> checked_mul(long long a, long long b) {
+  const bool overflows = a > 0 ? (b > 0 ? a > MAX / b : b < MIN / a)
+                               : (b > 0 ? a < MIN / b : a != 0 && b < MAX / a);
+  if (overflows)
+    return std::nullopt;
+  return a * b;
+}
+
+// Integer division, rounding towards zero like MiniZinc's `div`.
+std::optional<long long> checked_div(long long a, long long b) {
+  if (b == 0 || (a == MIN && b == -1))
+    return std::nullopt;
+  return a / b;
+}
+
+// The interval between `min` and `max`, where nullopt is an unknown end.
+IntInterval between(std::optional<long long> min, std::optional<long long> max) {
+  IntInterval r;
+  if (min) {
+    r.min = *min;
+    r.min_known = true;
+  }
+  if (max) {
+    r.max = *max;
+    r.max_known = true;
+  }
+  return r;
+}
+
+std::optional<long long> lower(IntInterval x) {
+  return x.min_known ? std::optional<long long>(x.min) : std::nullopt;
+}
+
+std::optional<long long> upper(IntInterval x) {
+  return x.max_known ? std::optional<long long>(x.max) : std::nullopt;
+}
+
+// `op(a, b)`, nullopt if either end is unknown.
+template <typename Op>
+std::optional<long long> both(std::optional<long long> a, std::optional<long long> b, Op op) {
+  if (!a || !b)
+    return std::nullopt;
+  return op(*a, *b);
+}
+
+// The smallest interval containing `op(a, b)` for the corners of `x` and `y`, which contains every
+// result if `op` is monotone in both arguments on the intervals.
+template <typename Op>
+IntInterval corners(IntInterval x, IntInterval y, Op op) {
+  if (!x.known() || !y.known())
+    return IntInterval::unknown();
+  IntInterval r = IntInterval::of(MAX, MIN);
+  for (long long a : {x.min, x.max}) {
+    for (long long b : {y.min, y.max}) {
+      const std::optional<long long> v = op(a, b);
+      if (!v)
+        return IntInterval::unknown();
+      r.min = std::min(r.min, *v);
+      r.max = std::max(r.max, *v);
+    }
+  }
+  return r;
+}
+
+IntInterval negate(IntInterval x) {
+  return between(upper(x) ? checked_neg(*upper(x)) : std::nullopt,
+                 lower(x) ? checked_neg(*lower(x)) : std::nullopt);
+}
+
+IntInterval add(IntInterval x, IntInterval y) {
+  return between(both(lower(x), lower(y), checked_add), both(upper(x), upper(y), checked_add));
+}
+
+// The smallest interval containing both `x` and `y`.
+IntInterval hull(IntInterval x, IntInterval y) {
+  auto min = [](long long a, long long b) { return std::optional<long long>(std::min(a, b)); };
+  auto max = [](long long a, long long b) { return std::optional<long long>(std::max(a, b)); };
+  return between(both(lower(x), lower(y), min), both(upper(x), upper(y), max));
+}
+
+// The intersection of `x` and `y`, where unknown ends could be anything.
+IntInterval intersect(IntInterval x, IntInterval y) {
+  std::optional<long long> min = lower(x) ? lower(x) : lower(y);
+  if (lower(x) && lower(y))
+    min = std::max(x.min, y.min);
+  std::optional<long long> max = upper(x) ? upper(x) : upper(y);
+  if (upper(x) && upper(y))
+    max = std::min(x.max, y.max);
+  if (min && max && *min > *max)
+    return IntInterval::unknown();
+  return between(min, max);
+}
+
+std::optional<long long> to_int(const MiniZinc::IntVal &v) {
+  if (!v.isFinite())
+    return std::nullopt;
+  return v.toInt();
+}
+
+// The bounds of an interval with the ends `min` and `max`.
+IntInterval range(IntInterval min, IntInterval max) {
+  if (min.min_known && max.max_known && min.min > max.max)
+    return IntInterval::unknown();
+  return between(lower(min), upper(max));
+}
+} // namespace
+
+namespace LZN {
+
+IntInterval IntBoundsAnalysis::bounds(const MiniZinc::Expression *e) {
+  if (e == nullptr)
+    return IntInterval::unknown();
+  if (auto it = exprs.find(e); it != exprs.end())
+    return it->second;
+  const IntInterval b = compute(e);
+  exprs.emplace(e, b);
+  return b;
+}
+
+IntInterval IntBoundsAnalysis::decl_bounds(const MiniZinc::VarDecl *vd) {
+  if (vd == nullptr)
+    return IntInterval::unknown();
+  // unknown while it is computed, in case it refers to itself
+  auto [it, inserted] = decls.emplace(vd, IntInterval::unknown());
+  if (!inserted)
+    return it->second;
+  const IntInterval b = compute_decl(vd);
+  decls[vd] = b;
+  return b;
+}
+
+IntInterval IntBoundsAnalysis::compute(const MiniZinc::Expression *e) {
+  using ExpressionId = MiniZinc::Expression::ExpressionId;
+  if (e->type().bt() != MiniZinc::Type::BT_INT)
+    return IntInterval::unknown();
+
+  switch (e->eid()) {
+  case ExpressionId::E_INTLIT: {
+    const auto v = to_int(e->cast<MiniZinc::IntLit>()->v());
+    return v ? IntInterval::of(*v, *v) : IntInterval::unknown();
+  }
+  case ExpressionId::E_SETLIT: {
+    auto sl = e->cast<MiniZinc::SetLit>();
+    if (auto isv = sl->isv(); isv != nullptr) {
+      if (isv->size() == 0)
+        return IntInterval::unknown();
+      return between(to_int(isv->min()), to_int(isv->max()));
+    }
+    const auto elems = sl->v();
+    if (elems.size() == 0)
+      return IntInterval::unknown();
+    IntInterval b = bounds(*elems.begin());
+    for (auto elem : elems) {
+      b = hull(b, bounds(elem));
+    }
+    return b;
+  }
+  case ExpressionId::E_ARRAYLIT: {
+    auto al = e->cast<MiniZinc::ArrayLit>();
+    if (al->size() == 0)
+      return IntInterval::unknown();
+    IntInterval b = bounds((*al)[0]);
+    for (unsigned int i = 1; i < al->size(); ++i) {
+      b = hull(b, bounds((*al)[i]));
+    }
+    return b;
+  }
+  case ExpressionId::E_ID: return decl_bounds(e->cast<MiniZinc::Id>()->decl());
+  case ExpressionId::E_ARRAYACCESS: return bounds(e->cast<MiniZinc::ArrayAccess>()->v());
+  case ExpressionId::E_COMP: return bounds(e->cast<MiniZinc::Comprehension>()->e());
+  case ExpressionId::E_ITE: {
+    auto ite = e->cast<MiniZinc::ITE>();
+    IntInterval b = bounds(ite->elseExpr());
+    for (unsigned int i = 0; i < ite->size(); ++i) {
+      b = hull(b, bounds(ite->thenExpr(i)));
+    }
+    return b;
+  }
+  case ExpressionId::E_BINOP: return compute(e->cast<MiniZinc::BinOp>());
+  case ExpressionId::E_UNOP: {
+    auto uo = e->cast<MiniZinc::UnOp>();
+    if (uo->op() == MiniZinc::UOT_PLUS)
+      return bounds(uo->e());
+    if (uo->op() == MiniZinc::UOT_MINUS)
+      return negate(bounds(uo->e()));
+    return IntInterval::unknown();
+  }
+  case ExpressionId::E_CALL: return compute(e->cast<MiniZinc::Call>());
+  case ExpressionId::E_VARDECL: return decl_bounds(e->cast<MiniZinc::VarDecl>());
+  case ExpressionId::E_LET: return bounds(e->cast<MiniZinc::Let>()->in());
+  default: return IntInterval::unknown();
+  }
+}
+
+IntInterval IntBoundsAnalysis::compute(const MiniZinc::BinOp *bo) {
+  const IntInterval lhs = bounds(bo->lhs());
+  const IntInterval rhs = bounds(bo->rhs());
+  switch (bo->op()) {
+  case BT::BOT_PLUS: return add(lhs, rhs);
+  case BT::BOT_MINUS: return add(lhs, negate(rhs));
+  case BT::BOT_MULT: return corners(lhs, rhs, checked_mul);
+  case BT::BOT_IDIV:
+    // `div` isn't monotone over a divisor that can be zero
+    if (!rhs.known() || (rhs.min <= 0 && rhs.max >= 0))
+      return IntInterval::unknown();
+    return corners(lhs, rhs, checked_div);
+  case BT::BOT_DOTDOT: return range(lhs, rhs);
+  case BT::BOT_UNION: return hull(lhs, rhs);
+  case BT::BOT_INTERSECT: return intersect(lhs, rhs);
+  case BT::BOT_DIFF: return lhs;
+  case BT::BOT_PLUSPLUS: return hull(lhs, rhs);
+  default: return IntInterval::unknown();
+  }
+}
+
+IntInterval IntBoundsAnalysis::compute(const MiniZinc::Call *call) {
+  const MiniZinc::ASTString name = call->id();
+  const char *id = name.c_str();
+  if (strcmp(id, "bool2int") == 0)
+    return IntInterval::of(0, 1);
+  if (strcmp(id, "min") == 0 || strcmp(id, "max") == 0) {
+    // both `min(x, y)` and `min(xs)` are within the bounds of all their arguments
+    if (call->argCount() == 0)
+      return IntInterval::unknown();
+    IntInterval b = bounds(call->arg(0));
+    for (unsigned int i = 1; i < call->argCount(); ++i) {
+      b = hull(b, bounds(call->arg(i)));
+    }
+    return b;
+  }
+  if (strcmp(id, "abs") == 0 && call->argCount() == 1) {
+    const IntInterval x = bounds(call->arg(0));
+    if (x.min_known && x.min >= 0)
+      return x;
+    if (x.max_known && x.max <= 0)
+      return negate(x);
+    const IntInterval neg = negate(x);
+    if (x.max_known && neg.max_known)
+      return IntInterval::of(0, std::max(x.max, neg.max));
+    return IntInterval::at_least(0);
+  }
+  // otherwise trust the declared return type of the function
+  if (auto fi = call->decl(); fi != nullptr && fi->ti() != nullptr)
+    return bounds(fi->ti()->domain());
+  return IntInterval::unknown();
+}
+
+IntInterval IntBoundsAnalysis::compute_decl(const MiniZinc::VarDecl *vd) {
+  IntInterval b = IntInterval::unknown();
+  if (generator_range) {
+    if (auto in = generator_range(vd); in != nullptr)
+      b = bounds(in);
+  }
+  b = intersect(b, bounds(vd->ti()->domain()));
+  if (vd->type().bt() == MiniZinc::Type::BT_INT)
+    b = intersect(b, bounds(vd->e()));
+  return b;
+}
+
+} // namespace LZN
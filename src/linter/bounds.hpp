@@ -0,0 +1,63 @@
+#pragma once
+#include <functional>
+#include <minizinc/ast.hh>
+#include <unordered_map>
+#include <utility>
+
+namespace LZN {
+
+// A closed interval of integers where either end can be unknown, meaning that nothing is known
+// about how far it goes in that direction.
+struct IntInterval {
+  long long min = 0;
+  long long max = 0;
+  bool min_known = false;
+  bool max_known = false;
+
+  static IntInterval unknown() { return IntInterval(); }
+  static IntInterval of(long long min, long long max) { return IntInterval{min, max, true, true}; }
+  static IntInterval at_least(long long min) { return IntInterval{min, 0, true, false}; }
+  static IntInterval at_most(long long max) { return IntInterval{0, max, false, true}; }
+  // Returns true if both ends are known.
+  bool known() const noexcept { return min_known && max_known; }
+  // Returns true if the bounds are known to be exactly `min..max`.
+  bool is(long long lo, long long hi) const noexcept { return known() && min == lo && max == hi; }
+  bool operator==(const IntInterval &other) const noexcept {
+    return min_known == other.min_known && max_known == other.max_known &&
+           (!min_known || min == other.min) && (!max_known || max == other.max);
+  }
+};
+
+// Finds bounds of integer expressions with interval arithmetic over the typed AST, without
+// evaluating anything. The bounds of a set or an array are the bounds of its elements, so the
+// bounds of `xs[i]` are the bounds of the elements of `xs` whatever `i` is, and a generator
+// variable gets the bounds of what it iterates over. What isn't understood, or would overflow, is
+// unknown, one end at a time where possible, so `1..n` starts at 1 whatever `n` is. Unlike
+// `MiniZinc::compute_int_bounds` nothing is thrown. Every result is cached.
+class IntBoundsAnalysis {
+public:
+  // What the generator variable `vd` iterates over, nullptr if `vd` isn't a generator variable.
+  using GeneratorRange = std::function<const MiniZinc::Expression *(const MiniZinc::VarDecl *vd)>;
+
+private:
+  GeneratorRange generator_range;
+  std::unordered_map<const MiniZinc::Expression *, IntInterval> exprs;
+  std::unordered_map<const MiniZinc::VarDecl *, IntInterval> decls;
+
+public:
+  explicit IntBoundsAnalysis(GeneratorRange generator_range)
+      : generator_range(std::move(generator_range)) {}
+
+  // The bounds of `e`, or of its elements if it is a set or an array.
+  IntInterval bounds(const MiniZinc::Expression *e);
+  // The bounds of the values of `vd`, or of its elements if it is a set or an array.
+  IntInterval decl_bounds(const MiniZinc::VarDecl *vd);
+
+private:
+  IntInterval compute(const MiniZinc::Expression *e);
+  IntInterval compute(const MiniZinc::BinOp *bo);
+  IntInterval compute(const MiniZinc::Call *call);
+  IntInterval compute_decl(const MiniZinc::VarDecl *vd);
+};
+
+} // namespace LZN
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <linter/cache.hpp>
+#include <linter/hash.hpp>
+#include <linter/result_io.hpp>
+#include <sstream>
+#include <unistd.h>
+
+#ifndef LZN_VERSION
+#define LZN_VERSION "unknown"
+#endif
+
+namespace {
+using namespace LZN;
+
+// Change when the format of the entries changes.
+constexpr std::uint32_t FORMAT = 1;
+constexpr std::uint32_t MAGIC = 0x434e5a4c;       // "LZNC"
+constexpr std::uint32_t ITEMS_MAGIC = 0x494e5a4c; // "LZNI"
+
+std::optional<std::string> read_file(const std::string &path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f)
+    return std::nullopt;
+  std::ostringstream contents;
+  contents << f.rdbuf();
+  return contents.str();
+}
+
+// The hash of the contents of the file `path`, nullopt if it can't be read.
+std::optional<std::pair<std::uint64_t, std::uint64_t>> file_hash(const std::string &path) {
+  const auto contents = read_file(path);
+  if (!contents)
+    return std::nullopt;
+  return Hasher().add(*contents).digest();
+}
+
+// Add the paths and the contents of the data files of `target` to `h`, false if one can't be read.
+bool add_datafiles(Hasher &h, const LintTarget &target) {
+  for (const auto &data : target.datafiles) {
+    const auto contents = read_file(data);
+    if (!contents)
+      return false;
+    h.add(data).add(*contents);
+  }
+  return true;
+}
+
+// Write `contents` to `path` by renaming a temporary file, so that nobody reads half an entry.
+void write_atomically(const std::string &path, const std::string &contents) {
+  static std::atomic<unsigned int> counter{0};
+  const std::string tmp = path + '.' + std::to_string(::getpid()) + '.' +
+                          std::to_string(counter++) + ".tmp";
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    f.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    if (!f) {
+      std::remove(tmp.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0)
+    std::remove(tmp.c_str());
+}
+} // namespace
+
+namespace LZN {
+
+ResultCache::ResultCache(std::string dir, const std::vector<std::string> &include_paths,
+                         const std::vector<const LintRule *> &rules)
+    : dir(std::move(dir)) {
+  Hasher h;
+  h.add(LZN_VERSION).add(std::to_string(FORMAT));
+  for (const auto &path : include_paths) {
+    h.add(path);
+  }
+  std::vector<lintId> ids;
+  for (auto rule : rules) {
+    ids.push_back(rule->id);
+  }
+  std::sort(ids.begin(), ids.end());
+  for (auto id : ids) {
+    h.add(std::to_string(id));
+  }
+  session_key = h.hex();
+
+  std::error_code ec;
+  std::filesystem::create_directories(this->dir, ec);
+}
+
+std::optional<std::string> ResultCache::entry_path(const LintTarget &target) const {
+  Hasher h;
+  h.add(session_key).add(target.model);
+  const auto model = target.contents ? target.contents : read_file(target.model);
+  if (!model)
+    return std::nullopt;
+  h.add(*model);
+  if (!add_datafiles(h, target))
+    return std::nullopt;
+  return dir + '/' + h.hex() + ".lzn";
+}
+
+std::optional<std::string> ResultCache::items_path(const LintTarget &target) const {
+  Hasher h;
+  h.add(session_key).add(target.model);
+  if (!add_datafiles(h, target))
+    return std::nullopt;
+  return dir + '/' + h.hex() + ".items";
+}
+
+std::optional<std::vector<LintResult>> ResultCache::lookup(const LintTarget &target) const {
+  const auto path = entry_path(target);
+  if (!path)
+    return std::nullopt;
+  const auto entry = read_file(*path);
+  if (!entry)
+    return std::nullopt;
+
+  BinaryReader r(*entry);
+  if (r.u32() != MAGIC || r.u32() != FORMAT)
+    return std::nullopt;
+  for (std::uint32_t i = r.u32(); i > 0 && r.ok(); --i) {
+    const std::string file = r.str();
+    const std::uint64_t h1 = r.u64();
+    const std::uint64_t h2 = r.u64();
+    if (!r.ok() || file_hash(file) != std::make_pair(h1, h2))
+      return std::nullopt;
+  }
+  auto results = read_results(r);
+  if (!results || !r.at_end())
+    return std::nullopt;
+  return results;
+}
+
+void ResultCache::store(const LintTarget &target, const std::vector<LintResult> &results,
+                        const std::vector<std::string> &included_files) const {
+  const auto path = entry_path(target);
+  if (!path)
+    return;
+
+  std::string entry;
+  BinaryWriter w(entry);
+  w.u32(MAGIC);
+  w.u32(FORMAT);
+  w.u32(static_cast<std::uint32_t>(included_files.size()));
+  for (const auto &file : included_files) {
+    const auto hash = file_hash(file);
+    if (!hash)
+      return;
+    w.str(file);
+    w.u64(hash->first);
+    w.u64(hash->second);
+  }
+  write_results(w, results);
+  write_atomically(*path, entry);
+}
+
+ItemResults ResultCache::lookup_items(const LintTarget &target) const {
+  const auto path = items_path(target);
+  if (!path)
+    return {};
+  const auto entry = read_file(*path);
+  if (!entry)
+    return {};
+
+  BinaryReader r(*entry);
+  if (r.u32() != ITEMS_MAGIC || r.u32() != FORMAT)
+    return {};
+  ItemResults items;
+  for (std::uint32_t i = r.u32(); i > 0 && r.ok(); --i) {
+    const lintId rule = r.u32();
+    const std::uint64_t fingerprint = r.u64();
+    auto results = read_results(r);
+    if (!results)
+      return {};
+    items.emplace(std::make_pair(rule, fingerprint), std::move(*results));
+  }
+  if (!r.ok() || !r.at_end())
+    return {};
+  return items;
+}
+
+void ResultCache::store_items(const LintTarget &target, const ItemResults &items) const {
+  const auto path = items_path(target);
+  if (!path)
+    return;
+
+  std::string entry;
+  BinaryWriter w(entry);
+  w.u32(ITEMS_MAGIC);
+  w.u32(FORMAT);
+  w.u32(static_cast<std::uint32_t>(items.size()));
+  for (const auto &[key, results] : items) {
+    w.u32(key.first);
+    w.u64(key.second);
+    write_results(w, results);
+  }
+  write_atomically(*path, entry);
+}
+
+} // namespace LZN
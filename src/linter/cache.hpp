@@ -0,0 +1,48 @@
+#pragma once
+#include <linter/incremental.hpp>
+#include <linter/rules.hpp>
+#include <linter/target.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace LZN {
+
+// Lint results stored on disk, one file per model named by a hash of everything the results depend
+// on: the linter version, the standard library path, the rules that are run, and the contents of
+// the model and its data files. The user defined files the model includes are only known after
+// parsing, so their hashes are stored in the entry and checked on lookup. Entries are written to a
+// temporary file and renamed into place, so several processes can share a directory.
+//
+// A model that has changed gets its results of the rules with `RuleScope::ITEM` from the last time
+// it was linted, see `run_incrementally`. They are stored in another file per model, named by the
+// same hash without the contents of the model.
+class ResultCache {
+  std::string dir;
+  std::string session_key; // what the entries of every model depend on
+
+public:
+  // The entries in `dir` of the results of `rules` with the standard library in `include_paths`.
+  ResultCache(std::string dir, const std::vector<std::string> &include_paths,
+              const std::vector<const LintRule *> &rules);
+
+  // The stored results of `target`, nullopt if there are none or anything has changed since.
+  std::optional<std::vector<LintResult>> lookup(const LintTarget &target) const;
+  // Store the `results` of `target`, which includes the user defined files `included_files`.
+  // Failing to write the entry just leaves it out of the cache.
+  void store(const LintTarget &target, const std::vector<LintResult> &results,
+             const std::vector<std::string> &included_files) const;
+
+  // The stored results of the items of `target`, empty if there are none.
+  ItemResults lookup_items(const LintTarget &target) const;
+  // Store the results of the items of `target`.
+  void store_items(const LintTarget &target, const ItemResults &items) const;
+
+private:
+  // The path of the entry of `target`, nullopt if the model or a data file can't be read.
+  std::optional<std::string> entry_path(const LintTarget &target) const;
+  // The path of the item results of `target`, nullopt if a data file can't be read.
+  std::optional<std::string> items_path(const LintTarget &target) const;
+};
+
+} // namespace LZN
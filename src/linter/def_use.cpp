@@ -0,0 +1,179 @@
+#include <linter/def_use.hpp>
+#include <utility>
+
+namespace {
+using namespace LZN;
+using ExpressionId = MiniZinc::Expression::ExpressionId;
+
+// Call `f(tree, node)` with the subtree of `e` in `tree`, or in a tree of its own if it isn't in
+// `tree`. Does nothing if `e` is nullptr.
+template <typename F>
+void with_subtree(const FlatTree &tree, const MiniZinc::Expression *e, F f) {
+  if (e == nullptr)
+    return;
+  const std::size_t node = tree.index_of(e);
+  if (node != FlatTree::NONE) {
+    f(tree, node);
+  } else {
+    const FlatTree own(e);
+    f(own, 0);
+  }
+}
+
+// Call `f(site, decl)` for every `Id` and `Call` in the subtree of `node` that refers to a
+// declaration. The children of `VarDecl`s are skipped, like `filter_out_vardecls` does.
+template <typename F>
+void for_each_reference(const FlatTree &tree, std::size_t node, F f) {
+  constexpr Impl::KindSet references =
+      Impl::kind_bit(ExpressionId::E_ID) | Impl::kind_bit(ExpressionId::E_CALL);
+  const std::size_t end = tree.end(node);
+  for (std::size_t cur = node; cur < end;) {
+    if ((tree.subtree_kinds(cur) & references) == 0) {
+      cur = tree.end(cur);
+      continue;
+    }
+    const MiniZinc::Expression *e = tree.expr(cur);
+    if (auto id = e->dynamicCast<MiniZinc::Id>(); id != nullptr && id->decl() != nullptr) {
+      f(e, DefUseIndex::Decl(id->decl()));
+    } else if (auto call = e->dynamicCast<MiniZinc::Call>();
+               call != nullptr && call->decl() != nullptr) {
+      f(e, DefUseIndex::Decl(call->decl()));
+    }
+    cur = e->isa<MiniZinc::VarDecl>() ? tree.end(cur) : cur + 1;
+  }
+}
+
+// Call `f(vd)` for every `VarDecl` in the subtree of `node`, at any depth.
+template <typename F>
+void for_each_vardecl(const FlatTree &tree, std::size_t node, F f) {
+  const std::size_t end = tree.end(node);
+  for (std::size_t cur = node; cur < end;) {
+    if (!tree.may_contain(cur, Impl::kind_bit(ExpressionId::E_VARDECL))) {
+      cur = tree.end(cur);
+      continue;
+    }
+    if (auto vd = tree.expr(cur)->dynamicCast<MiniZinc::VarDecl>(); vd != nullptr)
+      f(vd);
+    ++cur;
+  }
+}
+
+// Sort `edges` by their first element into rows, keeping the order within each row.
+template <typename T>
+void fill_rows(std::size_t num_rows, const std::vector<std::pair<std::size_t, T>> &edges,
+               std::vector<std::size_t> &offsets, std::vector<T> &values) {
+  offsets.assign(num_rows + 1, 0);
+  for (const auto &edge : edges) {
+    ++offsets[edge.first + 1];
+  }
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+  std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+  values.resize(edges.size());
+  for (const auto &edge : edges) {
+    values[next[edge.first]++] = edge.second;
+  }
+}
+} // namespace
+
+namespace LZN {
+
+DefUseIndex::DefUseIndex(const FlatTree &tree,
+                         const std::vector<const MiniZinc::FunctionI *> &funcs,
+                         const std::vector<const MiniZinc::VarDecl *> &vardecls) {
+  auto add = [this](Decl d) {
+    if (numbers.emplace(d, decls.size()).second)
+      decls.push_back(d);
+  };
+  for (auto fi : funcs) {
+    add(fi);
+    for (auto param : fi->params()) {
+      add(param);
+    }
+  }
+  for (auto vd : vardecls) {
+    add(vd);
+  }
+
+  std::vector<std::pair<std::size_t, Use>> uses, users;
+  std::vector<std::pair<std::size_t, std::size_t>> contained;
+  auto collect_uses = [&](std::size_t d) {
+    return [&, d](const FlatTree &t, std::size_t node) {
+      for_each_reference(t, node, [&](const MiniZinc::Expression *site, Decl used) {
+        const std::size_t u = number_of(used);
+        uses.emplace_back(d, Use{u, site});
+        if (u != NONE)
+          users.emplace_back(u, Use{d, site});
+      });
+    };
+  };
+  auto collect_contained = [&](std::size_t d) {
+    return [&, d](const FlatTree &t, std::size_t node) {
+      for_each_vardecl(t, node, [&](const MiniZinc::VarDecl *vd) {
+        const std::size_t c = number_of(vd);
+        if (c != NONE)
+          contained.emplace_back(d, c);
+      });
+    };
+  };
+
+  for (std::size_t d = 0; d < decls.size(); ++d) {
+    if (auto fi = std::get_if<const MiniZinc::FunctionI *>(&decls[d])) {
+      with_subtree(tree, (*fi)->e(), collect_uses(d));
+      with_subtree(tree, (*fi)->e(), collect_contained(d));
+    } else {
+      auto vd = std::get<const MiniZinc::VarDecl *>(decls[d]);
+      with_subtree(tree, vd->e(), collect_uses(d));
+      with_subtree(tree, vd->ti(), collect_uses(d));
+      with_subtree(tree, vd->e(), collect_contained(d));
+    }
+  }
+
+  for (std::size_t it = 0; it < tree.num_items(); ++it) {
+    const MiniZinc::Item *item = tree.item(it);
+    if (!item->isa<MiniZinc::ConstraintI>() && !item->isa<MiniZinc::SolveI>() &&
+        !item->isa<MiniZinc::OutputI>())
+      continue;
+    const auto [roots_begin, roots_end] = tree.item_roots(it);
+    for (auto root = roots_begin; root < roots_end; ++root) {
+      for_each_reference(tree, tree.root_node(root),
+                         [this](const MiniZinc::Expression *site, Decl used) {
+                           _root_uses.push_back(Use{number_of(used), site});
+                         });
+    }
+  }
+
+  fill_rows(decls.size(), uses, _uses.offsets, _uses.values);
+  fill_rows(decls.size(), users, _users.offsets, _users.values);
+  fill_rows(decls.size(), contained, _contained.offsets, _contained.values);
+}
+
+std::size_t DefUseIndex::number_of(const Decl &d) const {
+  auto it = numbers.find(d);
+  return it != numbers.end() ? it->second : NONE;
+}
+
+std::vector<bool> DefUseIndex::reachable_from_roots() const {
+  std::vector<bool> reached(decls.size(), false);
+  std::vector<std::size_t> stack;
+  for (const Use &u : _root_uses) {
+    if (u.decl != NONE && !reached[u.decl]) {
+      reached[u.decl] = true;
+      stack.push_back(u.decl);
+    }
+  }
+  while (!stack.empty()) {
+    const std::size_t d = stack.back();
+    stack.pop_back();
+    for (const Use &u : uses(d)) {
+      if (u.decl != NONE && !reached[u.decl]) {
+        reached[u.decl] = true;
+        stack.push_back(u.decl);
+      }
+    }
+  }
+  return reached;
+}
+
+} // namespace LZN
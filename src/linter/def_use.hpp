@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <linter/searcher.hpp>
+#include <minizinc/ast.hh>
+#include <minizinc/model.hh>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace LZN {
+
+// Which user defined declarations use which, for all user defined functions and variable
+// declarations. Every declaration gets a dense number and the edges are stored as compressed sparse
+// rows, so "what does X use", "who uses X" and reachability are scans over arrays.
+//
+// A declaration uses what the `Id`s and `Call`s in its definition refer to: the body of a function,
+// or the right hand side and the domains of a variable. Like `filter_out_vardecls`, the definitions
+// of declarations nested in a definition belong to the nested declaration and not to the outer one.
+class DefUseIndex {
+public:
+  using Decl = std::variant<const MiniZinc::FunctionI *, const MiniZinc::VarDecl *>;
+  static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+  // An `Id` or `Call` and the declaration it refers to, `NONE` if that isn't a user defined one.
+  // In the rows of `users` it is the declaration the `Id` or `Call` is in instead.
+  struct Use {
+    std::size_t decl;
+    const MiniZinc::Expression *site;
+  };
+
+  template <typename T>
+  class Row {
+    const T *first;
+    const T *last;
+
+  public:
+    Row(const T *first, const T *last) : first(first), last(last) {}
+    const T *begin() const noexcept { return first; }
+    const T *end() const noexcept { return last; }
+    std::size_t size() const noexcept { return last - first; }
+    bool empty() const noexcept { return first == last; }
+  };
+
+private:
+  template <typename T>
+  struct Rows {
+    std::vector<std::size_t> offsets; // row `i` is `values[offsets[i]..offsets[i+1]]`
+    std::vector<T> values;
+
+    Row<T> row(std::size_t i) const {
+      return Row<T>(values.data() + offsets[i], values.data() + offsets[i + 1]);
+    }
+  };
+
+  std::vector<Decl> decls;
+  std::unordered_map<Decl, std::size_t> numbers;
+  Rows<Use> _uses;
+  Rows<Use> _users;
+  Rows<std::size_t> _contained;
+  std::vector<Use> _root_uses;
+
+public:
+  // Index `funcs` and `vardecls`, the parameters of `funcs` are indexed as well. All of them are
+  // looked up in `tree`, the ones that aren't in it are flattened on their own.
+  DefUseIndex(const FlatTree &tree, const std::vector<const MiniZinc::FunctionI *> &funcs,
+              const std::vector<const MiniZinc::VarDecl *> &vardecls);
+
+  // The number of declarations.
+  std::size_t size() const noexcept { return decls.size(); }
+  const Decl &decl(std::size_t d) const { return decls[d]; }
+  // The number of `d`, or `NONE` if it isn't indexed.
+  std::size_t number_of(const Decl &d) const;
+
+  // Everything `d` uses, in the order they occur.
+  Row<Use> uses(std::size_t d) const { return _uses.row(d); }
+  // Every use of `d`, `Use::decl` is the declaration using it.
+  Row<Use> users(std::size_t d) const { return _users.row(d); }
+  // The indexed variable declarations in the definition of `d`, at any depth.
+  Row<std::size_t> contained(std::size_t d) const { return _contained.row(d); }
+  // Everything used by constraint, solve and output items.
+  const std::vector<Use> &root_uses() const noexcept { return _root_uses; }
+
+  // Whether each declaration is reachable from `root_uses` through `uses`.
+  std::vector<bool> reachable_from_roots() const;
+};
+
+} // namespace LZN
@@ -0,0 +1,94 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace LZN {
+
+// Numbers pointers densely from 0, in the order they are added, so that they can be used as
+// indices into an `IdSet` or an `IdMap` instead of as keys of hash containers.
+template <typename T>
+class DenseIds {
+  std::vector<const T *> elems;
+  std::unordered_map<const T *, std::size_t> numbers;
+
+public:
+  static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+  DenseIds() = default;
+  template <typename It>
+  DenseIds(It first, It last) {
+    for (; first != last; ++first) {
+      add(*first);
+    }
+  }
+
+  // Number `p`, if it isn't already, and return its id.
+  std::size_t add(const T *p) {
+    auto [it, inserted] = numbers.emplace(p, elems.size());
+    if (inserted)
+      elems.push_back(p);
+    return it->second;
+  }
+  // The id of `p`, or `NONE` if it isn't numbered.
+  std::size_t id_of(const T *p) const {
+    auto it = numbers.find(p);
+    return it != numbers.end() ? it->second : NONE;
+  }
+  const T *operator[](std::size_t id) const { return elems[id]; }
+  std::size_t size() const noexcept { return elems.size(); }
+  auto begin() const noexcept { return elems.begin(); }
+  auto end() const noexcept { return elems.end(); }
+};
+
+// A set of the ids 0..size-1, one bit per id.
+class IdSet {
+  using Word = std::uint64_t;
+  static constexpr std::size_t WORD_BITS = 64;
+
+  std::vector<Word> words;
+  std::size_t num_ids;
+
+public:
+  explicit IdSet(std::size_t size = 0) : words((size + WORD_BITS - 1) / WORD_BITS), num_ids(size) {}
+
+  std::size_t size() const noexcept { return num_ids; }
+  bool contains(std::size_t id) const {
+    assert(id < num_ids);
+    return (words[id / WORD_BITS] >> (id % WORD_BITS)) & 1;
+  }
+  void insert(std::size_t id) {
+    assert(id < num_ids);
+    words[id / WORD_BITS] |= Word(1) << (id % WORD_BITS);
+  }
+  void erase(std::size_t id) {
+    assert(id < num_ids);
+    words[id / WORD_BITS] &= ~(Word(1) << (id % WORD_BITS));
+  }
+  bool empty() const noexcept {
+    for (Word w : words) {
+      if (w != 0)
+        return false;
+    }
+    return true;
+  }
+  // Call `f(id)` for every id in the set, in increasing order.
+  template <typename F>
+  void for_each(F f) const {
+    for (std::size_t i = 0; i < words.size(); ++i) {
+      std::size_t id = i * WORD_BITS;
+      for (Word w = words[i]; w != 0; w >>= 1, ++id) {
+        if (w & 1)
+          f(id);
+      }
+    }
+  }
+};
+
+// A value for every id 0..size-1.
+template <typename V>
+using IdMap = std::vector<V>;
+
+} // namespace LZN
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+namespace LZN {
+
+// A 128 bit hash: 64 bit FNV-1a and a multiplicative hash with another multiplier, fed the same
+// bytes. It isn't cryptographic, only meant to tell apart things that differ.
+class Hasher {
+  std::uint64_t h1 = 0xcbf29ce484222325;
+  std::uint64_t h2 = 0x6a09e667f3bcc908;
+
+public:
+  // Add the 8 bytes of `v`, least significant first.
+  Hasher &add(std::uint64_t v) {
+    for (int i = 0; i < 8; ++i, v >>= 8) {
+      byte(static_cast<std::uint8_t>(v));
+    }
+    return *this;
+  }
+  // Add `s`, prefixed by its length so that consecutive strings can't run into each other.
+  Hasher &add(const std::string &s) {
+    add(s.size());
+    for (const char c : s) {
+      byte(static_cast<std::uint8_t>(c));
+    }
+    return *this;
+  }
+
+  // The FNV-1a half, for when 64 bits are enough.
+  std::uint64_t value() const noexcept { return h1; }
+  std::pair<std::uint64_t, std::uint64_t> digest() const noexcept { return {h1, h2}; }
+  std::string hex() const {
+    char buf[33];
+    std::snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(h1),
+                  static_cast<unsigned long long>(h2));
+    return buf;
+  }
+
+private:
+  void byte(std::uint8_t b) {
+    h1 = (h1 ^ b) * 0x100000001b3;
+    h2 = (h2 ^ b) * 0x9e3779b97f4a7c15;
+    h2 ^= h2 >> 29;
+  }
+};
+
+} // namespace LZN
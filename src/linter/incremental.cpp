@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <iterator>
+#include <linter/hash.hpp>
+#include <linter/incremental.hpp>
+#include <linter/overload.hpp>
+#include <minizinc/prettyprinter.hh>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+using namespace LZN;
+
+// The fingerprint of item number `it` of `tree` alone, without what it refers to.
+std::uint64_t own_fingerprint(const FlatTree &tree, std::size_t it) {
+  const MiniZinc::Item *item = tree.item(it);
+  const MiniZinc::Location &base = item->loc();
+  Hasher h;
+  // results on the first line of the item have columns that depend on where the item starts
+  h.add(item->iid()).add(base.firstColumn());
+
+  std::ostringstream printed;
+  MiniZinc::Printer p(printed, 0, false);
+  p.print(item);
+  h.add(printed.str());
+
+  // the printed item has neither the types nor the locations of the expressions
+  const auto [roots_begin, roots_end] = tree.item_roots(it);
+  for (auto root = roots_begin; root < roots_end; ++root) {
+    const std::size_t node = tree.root_node(root);
+    h.add(root - roots_begin);
+    for (std::size_t cur = node; cur < tree.end(node); ++cur) {
+      const MiniZinc::Expression *e = tree.expr(cur);
+      const MiniZinc::Type &t = e->type();
+      const MiniZinc::Location &loc = e->loc();
+      h.add(e->eid()).add(tree.depth(cur));
+      h.add(t.ti()).add(t.st()).add(t.bt()).add(t.ot()).add(static_cast<std::uint64_t>(t.dim()));
+      h.add(loc.firstLine() - base.firstLine()).add(loc.firstColumn());
+      h.add(loc.lastLine() - base.firstLine()).add(loc.lastColumn());
+    }
+  }
+  return h.value();
+}
+
+// The item of `tree` the declaration `e` refers to, nullptr if it doesn't refer to one in the tree.
+const MiniZinc::Item *referred_item(const FlatTree &tree, const MiniZinc::Expression *e) {
+  if (auto id = e->dynamicCast<MiniZinc::Id>(); id != nullptr && id->decl() != nullptr) {
+    const std::size_t node = tree.index_of(id->decl());
+    return node != FlatTree::NONE ? tree.item_of(node) : nullptr;
+  }
+  if (auto call = e->dynamicCast<MiniZinc::Call>(); call != nullptr)
+    return call->decl();
+  return nullptr;
+}
+
+// The lines of `c`, from its first to its last, nullopt if it has no region.
+std::optional<std::pair<unsigned int, unsigned int>> lines_of(const FileContents &c) {
+  return std::visit(overload{
+                        [](const std::monostate &)
+                            -> std::optional<std::pair<unsigned int, unsigned int>> {
+                          return std::nullopt;
+                        },
+                        [](const FileContents::OneLineMarked &olm)
+                            -> std::optional<std::pair<unsigned int, unsigned int>> {
+                          return std::make_pair(olm.line, olm.line);
+                        },
+                        [](const FileContents::MultiLine &ml)
+                            -> std::optional<std::pair<unsigned int, unsigned int>> {
+                          return std::make_pair(ml.startline, ml.endline);
+                        },
+                    },
+                    c.region);
+}
+
+// Returns true if `c` is somewhere within `item`.
+bool is_within(const FileContents &c, const MiniZinc::Item *item) {
+  const auto lines = lines_of(c);
+  const MiniZinc::Location &loc = item->loc();
+  if (!lines || c.filename != loc.filename().c_str())
+    return false;
+  if (lines->first < loc.firstLine() || lines->second > loc.lastLine())
+    return false;
+  // other items may start or end on the same lines
+  if (auto olm = std::get_if<FileContents::OneLineMarked>(&c.region)) {
+    if (olm->line == loc.firstLine() && olm->startcol < loc.firstColumn())
+      return false;
+    if (olm->line == loc.lastLine() && olm->startcol > loc.lastColumn())
+      return false;
+  }
+  return true;
+}
+
+// Move the region of `c`, if it has one, `by` lines down and into the file `filename`.
+void move(FileContents &c, long long by, const std::string &filename) {
+  if (std::holds_alternative<std::monostate>(c.region))
+    return;
+  const auto shift = [by](unsigned int &line) { line = static_cast<unsigned int>(line + by); };
+  if (auto olm = std::get_if<FileContents::OneLineMarked>(&c.region)) {
+    shift(olm->line);
+  } else if (auto ml = std::get_if<FileContents::MultiLine>(&c.region)) {
+    shift(ml->startline);
+    shift(ml->endline);
+  }
+  c.filename = filename;
+}
+
+// Move `r` and its sub results `by` lines down and into the file `filename`.
+void move(LintResult &r, long long by, const std::string &filename) {
+  move(r.content, by, filename);
+  for (auto &sub : r.sub_results) {
+    move(sub.content, by, filename);
+  }
+}
+} // namespace
+
+namespace LZN {
+
+ItemFingerprints::ItemFingerprints(const FlatTree &tree) {
+  // the items that can have results, and their numbers in the tree
+  std::vector<std::size_t> tree_items;
+  std::unordered_map<const MiniZinc::Item *, std::size_t> numbers;
+  for (std::size_t it = 0; it < tree.num_items(); ++it) {
+    const auto [roots_begin, roots_end] = tree.item_roots(it);
+    const MiniZinc::Item *item = tree.item(it);
+    if (item->isa<MiniZinc::IncludeI>() || roots_begin == roots_end)
+      continue;
+    if (numbers.emplace(item, tree_items.size()).second)
+      tree_items.push_back(it);
+  }
+
+  std::vector<std::uint64_t> own(tree_items.size());
+  std::vector<std::vector<std::size_t>> refers(tree_items.size());
+  for (std::size_t i = 0; i < tree_items.size(); ++i) {
+    own[i] = own_fingerprint(tree, tree_items[i]);
+    const auto [roots_begin, roots_end] = tree.item_roots(tree_items[i]);
+    for (auto root = roots_begin; root < roots_end; ++root) {
+      const std::size_t node = tree.root_node(root);
+      for (std::size_t cur = node; cur < tree.end(node); ++cur) {
+        auto it = numbers.find(referred_item(tree, tree.expr(cur)));
+        if (it != numbers.end() && it->second != i)
+          refers[i].push_back(it->second);
+      }
+    }
+    std::sort(refers[i].begin(), refers[i].end());
+    refers[i].erase(std::unique(refers[i].begin(), refers[i].end()), refers[i].end());
+  }
+
+  // combine the fingerprint of every item with the ones of everything it reaches
+  std::vector<std::size_t> reached_by(tree_items.size(), NONE);
+  std::vector<std::size_t> stack;
+  std::vector<std::uint64_t> reached;
+  entries.reserve(tree_items.size());
+  for (std::size_t i = 0; i < tree_items.size(); ++i) {
+    reached.clear();
+    reached_by[i] = i;
+    stack.push_back(i);
+    while (!stack.empty()) {
+      const std::size_t cur = stack.back();
+      stack.pop_back();
+      for (std::size_t next : refers[cur]) {
+        if (reached_by[next] == i)
+          continue;
+        reached_by[next] = i;
+        reached.push_back(own[next]);
+        stack.push_back(next);
+      }
+    }
+    std::sort(reached.begin(), reached.end());
+    Hasher h;
+    h.add(own[i]).add(reached.size());
+    for (std::uint64_t fp : reached) {
+      h.add(fp);
+    }
+    entries.push_back(Entry{tree.item(tree_items[i]), h.value()});
+  }
+
+  spans.reserve(entries.size());
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    const MiniZinc::Location &loc = entries[i].item->loc();
+    spans.push_back(Span{loc.filename().c_str(), loc.firstLine(), loc.lastLine(), i});
+  }
+  std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) {
+    return std::tie(a.filename, a.first_line) < std::tie(b.filename, b.first_line);
+  });
+}
+
+std::size_t ItemFingerprints::item_of(const LintResult &r) const {
+  const auto lines = lines_of(r.content);
+  if (!lines)
+    return NONE;
+
+  // the items are in order and don't overlap, so the ones the first line of `r` is in are the
+  // last ones that start before or on it
+  const auto first_after =
+      std::upper_bound(spans.begin(), spans.end(), std::tie(r.content.filename, lines->first),
+                       [](const auto &pos, const Span &span) {
+                         return pos < std::tie(span.filename, span.first_line);
+                       });
+  std::size_t found = NONE;
+  for (auto span = std::make_reverse_iterator(first_after); span != spans.rend(); ++span) {
+    if (span->filename != r.content.filename || span->last_line < lines->first)
+      break;
+    if (!is_within(r.content, entries[span->entry].item))
+      continue;
+    if (found != NONE)
+      return NONE;
+    found = span->entry;
+  }
+  if (found == NONE)
+    return NONE;
+
+  for (const auto &sub : r.sub_results) {
+    if (!sub.content.is_empty() && !is_within(sub.content, entries[found].item))
+      return NONE;
+  }
+  return found;
+}
+
+LintResult ItemFingerprints::relative(LintResult r, std::size_t i) const {
+  move(r, -static_cast<long long>(entries[i].item->loc().firstLine()), "");
+  return r;
+}
+
+LintResult ItemFingerprints::absolute(LintResult r, std::size_t i) const {
+  const MiniZinc::Location &loc = entries[i].item->loc();
+  move(r, loc.firstLine(), loc.filename().c_str());
+  return r;
+}
+
+std::vector<LintResult> run_incrementally(LintEnv &env, const std::vector<const LintRule *> &rules,
+                                          ItemResults &items, LintEnv::SearchStats &stats) {
+  std::vector<const LintRule *> model_rules, item_rules;
+  for (auto rule : rules) {
+    (rule->scope == RuleScope::ITEM ? item_rules : model_rules).push_back(rule);
+  }
+
+  const ItemFingerprints fingerprints(env.flat_tree());
+  std::vector<bool> changed(fingerprints.size(), false);
+  for (std::size_t i = 0; i < fingerprints.size(); ++i) {
+    changed[i] = std::any_of(item_rules.begin(), item_rules.end(), [&](const LintRule *rule) {
+      return items.count({rule->id, fingerprints[i].fingerprint}) == 0;
+    });
+  }
+
+  std::vector<LintResult> results, fresh;
+  if (std::find(changed.begin(), changed.end(), false) == changed.end()) {
+    results = env.lint(rules);
+    auto item_results = std::stable_partition(
+        results.begin(), results.end(),
+        [](const LintResult &r) { return r.rule->scope != RuleScope::ITEM; });
+    fresh.assign(std::make_move_iterator(item_results), std::make_move_iterator(results.end()));
+    results.erase(item_results, results.end());
+  } else {
+    results = env.lint(model_rules);
+    if (std::find(changed.begin(), changed.end(), true) != changed.end()) {
+      MiniZinc::Model changed_model;
+      for (std::size_t i = 0; i < fingerprints.size(); ++i) {
+        // NOTE: the items are only searched, not modified
+        if (changed[i])
+          changed_model.addItem(const_cast<MiniZinc::Item *>(fingerprints[i].item));
+      }
+      LintEnv changed_env(&changed_model, env.minizinc_env(), env.include_path(), env.jobs());
+      changed_env.prepass();
+      fresh = changed_env.lint(item_rules);
+      stats.hits += changed_env.search_stats().hits;
+      stats.misses += changed_env.search_stats().misses;
+    }
+  }
+
+  // the results of every item rule on every item, the new ones and the stored ones
+  std::unordered_map<const LintRule *, std::size_t> rule_numbers;
+  for (std::size_t r = 0; r < item_rules.size(); ++r) {
+    rule_numbers.emplace(item_rules[r], r);
+  }
+  std::vector<std::vector<std::vector<LintResult>>> per_item(
+      item_rules.size(), std::vector<std::vector<LintResult>>(fingerprints.size()));
+  std::vector<bool> storable(item_rules.size(), true);
+  std::vector<LintResult> unplaced;
+  for (auto &res : fresh) {
+    const std::size_t r = rule_numbers.at(res.rule);
+    const std::size_t i = fingerprints.item_of(res);
+    if (i == ItemFingerprints::NONE) {
+      storable[r] = false;
+      unplaced.push_back(std::move(res));
+    } else {
+      per_item[r][i].push_back(std::move(res));
+    }
+  }
+  for (std::size_t i = 0; i < fingerprints.size(); ++i) {
+    if (changed[i])
+      continue;
+    for (std::size_t r = 0; r < item_rules.size(); ++r) {
+      for (const auto &res : items.at({item_rules[r]->id, fingerprints[i].fingerprint})) {
+        per_item[r][i].push_back(fingerprints.absolute(res, i));
+      }
+    }
+  }
+
+  ItemResults next;
+  for (std::size_t r = 0; r < item_rules.size(); ++r) {
+    for (std::size_t i = 0; i < fingerprints.size(); ++i) {
+      if (storable[r]) {
+        auto &stored = next[{item_rules[r]->id, fingerprints[i].fingerprint}];
+        stored.clear();
+        for (const auto &res : per_item[r][i]) {
+          stored.push_back(fingerprints.relative(res, i));
+        }
+      }
+      std::move(per_item[r][i].begin(), per_item[r][i].end(), std::back_inserter(results));
+    }
+  }
+  std::move(unplaced.begin(), unplaced.end(), std::back_inserter(results));
+  items = std::move(next);
+
+  // in the same order as if all rules were run at once
+  std::unordered_map<const LintRule *, std::size_t> order;
+  for (std::size_t r = 0; r < rules.size(); ++r) {
+    order.emplace(rules[r], r);
+  }
+  std::stable_sort(results.begin(), results.end(), [&order](const auto &a, const auto &b) {
+    return order.at(a.rule) < order.at(b.rule);
+  });
+  return results;
+}
+
+} // namespace LZN
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <linter/rules.hpp>
+#include <linter/searcher.hpp>
+#include <map>
+#include <minizinc/ast.hh>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace LZN {
+
+// The results of the rules with `RuleScope::ITEM` by rule id and item fingerprint, see
+// `ItemFingerprints`. The lines of the results, and of their sub results, are relative to the first
+// line of their item and the file names are left out.
+using ItemResults = std::map<std::pair<lintId, std::uint64_t>, std::vector<LintResult>>;
+
+// The user defined items of a flat tree, each with a fingerprint of everything the results of a
+// rule with `RuleScope::ITEM` can depend on: the printed item, the kinds, types and locations of
+// its expressions, and the same for every user defined item it refers to, at any depth. Locations
+// are counted from the first line of the item, so an item that only moved up or down keeps its
+// fingerprint, and so do the results relative to it.
+class ItemFingerprints {
+public:
+  static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+  struct Entry {
+    const MiniZinc::Item *item;
+    std::uint64_t fingerprint;
+  };
+
+private:
+  // Where an item is, see `item_of`.
+  struct Span {
+    std::string filename;
+    unsigned int first_line;
+    unsigned int last_line;
+    std::size_t entry;
+  };
+
+  std::vector<Entry> entries; // in the same order as the items of the tree
+  std::vector<Span> spans;    // sorted by file and first line
+
+public:
+  explicit ItemFingerprints(const FlatTree &tree);
+
+  std::size_t size() const noexcept { return entries.size(); }
+  const Entry &operator[](std::size_t i) const { return entries[i]; }
+  auto begin() const noexcept { return entries.begin(); }
+  auto end() const noexcept { return entries.end(); }
+
+  // The number of the only item that `r` and all of its sub results that have a region are in,
+  // `NONE` if there isn't one. Only the items on the first line of `r` are looked at.
+  std::size_t item_of(const LintResult &r) const;
+  // `r` relative to item number `i`, which it must be in, see `ItemResults`.
+  LintResult relative(LintResult r, std::size_t i) const;
+  // The reverse of `relative`, `r` moved to where item number `i` is now.
+  LintResult absolute(LintResult r, std::size_t i) const;
+};
+
+// Run `rules` on the model of `env` like `LintEnv::lint`, except for the rules with
+// `RuleScope::ITEM` on the items that have results for all of them in `items`, which are taken from
+// there instead. `items` is then replaced by the results of the items of the model, to be given to
+// the next run. The searches of the rules run on changed items are added to `stats`.
+//
+// A rule can't be told to look at only some items, so the rules with `RuleScope::ITEM` are run on a
+// model of only the changed items. A rule with a result that isn't in exactly one item isn't
+// stored, and is run on every item the next time.
+std::vector<LintResult> run_incrementally(LintEnv &env, const std::vector<const LintRule *> &rules,
+                                          ItemResults &items, LintEnv::SearchStats &stats);
+
+} // namespace LZN
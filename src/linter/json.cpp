@@ -0,0 +1,307 @@
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <linter/json.hpp>
+
+namespace {
+using LZN::Json;
+
+// A recursive descent parser over a JSON text.
+class Parser {
+  const std::string &text;
+  std::size_t pos = 0;
+
+  // Nesting deeper than this is taken to be garbage, rather than overflowing the stack.
+  static constexpr int MAX_DEPTH = 512;
+
+public:
+  explicit Parser(const std::string &text) : text(text) {}
+
+  std::optional<Json> parse_text() {
+    auto v = parse_value(0);
+    skip_whitespace();
+    if (!v || pos != text.size())
+      return std::nullopt;
+    return v;
+  }
+
+private:
+  void skip_whitespace() {
+    while (pos < text.size() &&
+           (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r'))
+      ++pos;
+  }
+
+  bool consume(const char *word) {
+    std::size_t i = 0;
+    for (; word[i] != '\0'; ++i) {
+      if (pos + i >= text.size() || text[pos + i] != word[i])
+        return false;
+    }
+    pos += i;
+    return true;
+  }
+
+  std::optional<Json> parse_value(int depth) {
+    if (depth > MAX_DEPTH)
+      return std::nullopt;
+    skip_whitespace();
+    if (pos >= text.size())
+      return std::nullopt;
+    switch (text[pos]) {
+    case 'n': return consume("null") ? std::optional<Json>(nullptr) : std::nullopt;
+    case 't': return consume("true") ? std::optional<Json>(true) : std::nullopt;
+    case 'f': return consume("false") ? std::optional<Json>(false) : std::nullopt;
+    case '"': {
+      auto s = parse_string();
+      return s ? std::optional<Json>(std::move(*s)) : std::nullopt;
+    }
+    case '[': return parse_array(depth);
+    case '{': return parse_object(depth);
+    default: return parse_number();
+    }
+  }
+
+  std::optional<Json> parse_number() {
+    const std::size_t start = pos;
+    if (pos < text.size() && text[pos] == '-')
+      ++pos;
+    while (pos < text.size() && (std::isdigit(static_cast<unsigned char>(text[pos])) ||
+                                 text[pos] == '.' || text[pos] == 'e' || text[pos] == 'E' ||
+                                 text[pos] == '+' || text[pos] == '-'))
+      ++pos;
+    if (start == pos)
+      return std::nullopt;
+    const std::string num = text.substr(start, pos - start);
+    char *end = nullptr;
+    const double d = std::strtod(num.c_str(), &end);
+    if (end != num.c_str() + num.size())
+      return std::nullopt;
+    return Json(d);
+  }
+
+  std::optional<unsigned int> parse_hex4() {
+    if (pos + 4 > text.size())
+      return std::nullopt;
+    unsigned int v = 0;
+    for (int i = 0; i < 4; ++i) {
+      const char c = text[pos++];
+      v <<= 4;
+      if (c >= '0' && c <= '9')
+        v |= c - '0';
+      else if (c >= 'a' && c <= 'f')
+        v |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        v |= c - 'A' + 10;
+      else
+        return std::nullopt;
+    }
+    return v;
+  }
+
+  static void append_utf8(std::string &out, unsigned int cp) {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      out += static_cast<char>(0xC0 | (cp >> 6));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += static_cast<char>(0xE0 | (cp >> 12));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (cp >> 18));
+      out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  std::optional<std::string> parse_string() {
+    ++pos; // the opening quote
+    std::string s;
+    while (pos < text.size()) {
+      const char c = text[pos++];
+      if (c == '"')
+        return s;
+      if (c != '\\') {
+        s += c;
+        continue;
+      }
+      if (pos >= text.size())
+        return std::nullopt;
+      switch (text[pos++]) {
+      case '"': s += '"'; break;
+      case '\\': s += '\\'; break;
+      case '/': s += '/'; break;
+      case 'b': s += '\b'; break;
+      case 'f': s += '\f'; break;
+      case 'n': s += '\n'; break;
+      case 'r': s += '\r'; break;
+      case 't': s += '\t'; break;
+      case 'u': {
+        auto cp = parse_hex4();
+        if (!cp)
+          return std::nullopt;
+        // a surrogate pair is one code point
+        if (*cp >= 0xD800 && *cp < 0xDC00 && consume("\\u")) {
+          auto low = parse_hex4();
+          if (!low || *low < 0xDC00 || *low >= 0xE000)
+            return std::nullopt;
+          *cp = 0x10000 + ((*cp - 0xD800) << 10) + (*low - 0xDC00);
+        }
+        append_utf8(s, *cp);
+        break;
+      }
+      default: return std::nullopt;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<Json> parse_array(int depth) {
+    ++pos; // [
+    Json::Array arr;
+    skip_whitespace();
+    if (consume("]"))
+      return Json(std::move(arr));
+    while (true) {
+      auto v = parse_value(depth + 1);
+      if (!v)
+        return std::nullopt;
+      arr.push_back(std::move(*v));
+      skip_whitespace();
+      if (consume("]"))
+        return Json(std::move(arr));
+      if (!consume(","))
+        return std::nullopt;
+    }
+  }
+
+  std::optional<Json> parse_object(int depth) {
+    ++pos; // {
+    Json::Object obj;
+    skip_whitespace();
+    if (consume("}"))
+      return Json(std::move(obj));
+    while (true) {
+      skip_whitespace();
+      if (pos >= text.size() || text[pos] != '"')
+        return std::nullopt;
+      auto key = parse_string();
+      skip_whitespace();
+      if (!key || !consume(":"))
+        return std::nullopt;
+      auto v = parse_value(depth + 1);
+      if (!v)
+        return std::nullopt;
+      obj.emplace_back(std::move(*key), std::move(*v));
+      skip_whitespace();
+      if (consume("}"))
+        return Json(std::move(obj));
+      if (!consume(","))
+        return std::nullopt;
+    }
+  }
+};
+
+void dump_string(std::string &out, const std::string &s) {
+  out += '"';
+  for (const char c : s) {
+    switch (c) {
+    case '"': out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '\n': out += "\\n"; break;
+    case '\r': out += "\\r"; break;
+    case '\t': out += "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned int>(c));
+        out += buf;
+      } else {
+        out += c;
+      }
+    }
+  }
+  out += '"';
+}
+
+void dump_number(std::string &out, double d) {
+  if (!std::isfinite(d)) {
+    out += "null";
+    return;
+  }
+  char buf[32];
+  if (d == std::floor(d) && std::fabs(d) < 1e15)
+    std::snprintf(buf, sizeof(buf), "%.0f", d);
+  else
+    std::snprintf(buf, sizeof(buf), "%.17g", d);
+  out += buf;
+}
+} // namespace
+
+namespace LZN {
+
+const Json *Json::get(const std::string &key) const {
+  if (auto obj = object(); obj != nullptr) {
+    for (const auto &[k, v] : *obj) {
+      if (k == key)
+        return &v;
+    }
+  }
+  return nullptr;
+}
+
+const Json *Json::path(std::initializer_list<const char *> keys) const {
+  const Json *cur = this;
+  for (auto key : keys) {
+    cur = cur->get(key);
+    if (cur == nullptr)
+      return nullptr;
+  }
+  return cur;
+}
+
+std::optional<Json> Json::parse(const std::string &text) {
+  return Parser(text).parse_text();
+}
+
+std::string Json::dump() const {
+  std::string out;
+  dump(out);
+  return out;
+}
+
+void Json::dump(std::string &out) const {
+  if (is_null()) {
+    out += "null";
+  } else if (auto b = boolean()) {
+    out += *b ? "true" : "false";
+  } else if (auto d = number()) {
+    dump_number(out, *d);
+  } else if (auto s = string()) {
+    dump_string(out, *s);
+  } else if (auto arr = array()) {
+    out += '[';
+    for (std::size_t i = 0; i < arr->size(); ++i) {
+      if (i > 0)
+        out += ',';
+      (*arr)[i].dump(out);
+    }
+    out += ']';
+  } else if (auto obj = object()) {
+    out += '{';
+    for (std::size_t i = 0; i < obj->size(); ++i) {
+      if (i > 0)
+        out += ',';
+      dump_string(out, (*obj)[i].first);
+      out += ':';
+      (*obj)[i].second.dump(out);
+    }
+    out += '}';
+  }
+}
+
+} // namespace LZN
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace LZN {
+
+// A JSON value, just enough of it to speak the Language Server Protocol. Numbers are doubles and
+// objects keep their members in order, looking one up is a linear search.
+class Json {
+public:
+  using Array = std::vector<Json>;
+  using Object = std::vector<std::pair<std::string, Json>>;
+
+private:
+  std::variant<std::nullptr_t, bool, double, std::string, Array, Object> value;
+
+public:
+  Json() : value(nullptr) {}
+  Json(std::nullptr_t) : value(nullptr) {}
+  Json(bool b) : value(b) {}
+  Json(double d) : value(d) {}
+  Json(int i) : value(static_cast<double>(i)) {}
+  Json(unsigned int i) : value(static_cast<double>(i)) {}
+  Json(const char *s) : value(std::string(s)) {}
+  Json(std::string s) : value(std::move(s)) {}
+  Json(Array a) : value(std::move(a)) {}
+  Json(Object o) : value(std::move(o)) {}
+
+  bool is_null() const noexcept { return std::holds_alternative<std::nullptr_t>(value); }
+  // The value if it is of that type, nullptr otherwise.
+  const bool *boolean() const noexcept { return std::get_if<bool>(&value); }
+  const double *number() const noexcept { return std::get_if<double>(&value); }
+  const std::string *string() const noexcept { return std::get_if<std::string>(&value); }
+  const Array *array() const noexcept { return std::get_if<Array>(&value); }
+  const Object *object() const noexcept { return std::get_if<Object>(&value); }
+
+  // The member `key`, nullptr if this isn't an object or has no such member.
+  const Json *get(const std::string &key) const;
+  // Follow `keys` through nested objects, nullptr if any of them is missing.
+  const Json *path(std::initializer_list<const char *> keys) const;
+
+  // Parse a whole JSON text, nullopt if it isn't valid.
+  static std::optional<Json> parse(const std::string &text);
+  // The JSON text of this value, without any whitespace.
+  std::string dump() const;
+  void dump(std::string &out) const;
+};
+
+} // namespace LZN
@@ -0,0 +1,80 @@
+#include <cctype>
+#include <linter/lsp_utils.hpp>
+#include <linter/overload.hpp>
+
+namespace {
+using namespace LZN;
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+Json position(unsigned int line, unsigned int character) {
+  return Json::Object{{"line", line}, {"character", character}};
+}
+} // namespace
+
+namespace LZN {
+
+std::string uri_to_path(const std::string &uri) {
+  constexpr const char *scheme = "file://";
+  if (uri.compare(0, 7, scheme) != 0)
+    return uri;
+  std::string path;
+  for (std::size_t i = 7; i < uri.size(); ++i) {
+    if (uri[i] == '%' && i + 2 < uri.size() && hex_value(uri[i + 1]) >= 0 &&
+        hex_value(uri[i + 2]) >= 0) {
+      path += static_cast<char>(hex_value(uri[i + 1]) * 16 + hex_value(uri[i + 2]));
+      i += 2;
+    } else {
+      path += uri[i];
+    }
+  }
+  return path;
+}
+
+std::string path_to_uri(const std::string &path) {
+  constexpr const char *hex = "0123456789ABCDEF";
+  std::string uri = "file://";
+  for (const char c : path) {
+    const auto u = static_cast<unsigned char>(c);
+    if (std::isalnum(u) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~') {
+      uri += c;
+    } else {
+      uri += '%';
+      uri += hex[u >> 4];
+      uri += hex[u & 0xF];
+    }
+  }
+  return uri;
+}
+
+Json lsp_range(const FileContents &fc) {
+  auto at = [](unsigned int line, unsigned int character) {
+    return position(line > 0 ? line - 1 : 0, character);
+  };
+  return std::visit(
+      overload{
+          [&](const std::monostate &) {
+            return Json(Json::Object{{"start", position(0, 0)}, {"end", position(0, 0)}});
+          },
+          [&](const FileContents::OneLineMarked &olm) {
+            const unsigned int start = olm.startcol > 0 ? olm.startcol - 1 : 0;
+            const Json end = olm.endcol ? at(olm.line, *olm.endcol) : position(olm.line, 0);
+            return Json(Json::Object{{"start", at(olm.line, start)}, {"end", end}});
+          },
+          [&](const FileContents::MultiLine &ml) {
+            return Json(
+                Json::Object{{"start", at(ml.startline, 0)}, {"end", position(ml.endline, 0)}});
+          },
+      },
+      fc.region);
+}
+
+} // namespace LZN
@@ -0,0 +1,18 @@
+#pragma once
+#include <linter/json.hpp>
+#include <linter/rules.hpp>
+#include <string>
+
+namespace LZN {
+
+// The path of a `file://` URI, with percent-encoded bytes decoded, or the URI itself if it isn't
+// one.
+std::string uri_to_path(const std::string &uri);
+// The `file://` URI of `path`, with every byte that isn't unreserved percent-encoded.
+std::string path_to_uri(const std::string &path);
+
+// The LSP range of `fc`. MiniZinc lines and columns start at 1 and the end column is included, LSP
+// ones start at 0 and the end is excluded. An unknown end of a line becomes the start of the next.
+Json lsp_range(const FileContents &fc);
+
+} // namespace LZN
@@ -0,0 +1,277 @@
+#pragma once
+#include <linter/searcher.hpp>
+#include <minizinc/ast.hh>
+#include <tuple>
+#include <type_traits>
+
+// Search patterns that are known at compile time. They find the same hits as a `Search` built with
+// the same nodes and filters, but every node is matched and filtered by code specialised for it and
+// the hits are returned as tuples of correctly typed pointers.
+//
+// Example:
+//   using P = Pattern<Under<MiniZinc::BinOpType::BOT_EQ, Capture>,
+//                     Direct<MiniZinc::Expression::E_ID, Capture>>;
+//   P::search(tree, node, [](const P::Hit &hit, FlatTree::PathIters path) {
+//     auto [eq, id] = hit; // const MiniZinc::BinOp *, const MiniZinc::Id *
+//   });
+
+namespace LZN {
+
+// Options for the nodes of a pattern, see `SearchBuilder::capture` and `SearchBuilder::filter`.
+struct Capture {};
+template <ExprFilterFun F>
+struct Filter {};
+
+// The nodes of a pattern, see `SearchBuilder::under` and `SearchBuilder::direct`. `Target` is
+// either an `ExpressionId`, a `BinOpType` or an `UnOpType`.
+template <auto Target, typename... Options>
+struct Under;
+template <auto Target, typename... Options>
+struct Direct;
+
+// Filters to run on every visited node, see `SearchBuilder::global_filter`. Must be the first
+// argument of `Pattern` if present.
+template <ExprFilterFun... Fs>
+struct GlobalFilters {};
+
+} // namespace LZN
+
+namespace LZN::Impl {
+
+// The class of the expressions with id `Eid`.
+template <MiniZinc::Expression::ExpressionId Eid>
+struct ExpressionType;
+#define LZN_EXPRESSION_TYPE(EID, TYPE)                                                             \
+  template <>                                                                                      \
+  struct ExpressionType<MiniZinc::Expression::EID> {                                               \
+    using type = MiniZinc::TYPE;                                                                   \
+  }
+LZN_EXPRESSION_TYPE(E_INTLIT, IntLit);
+LZN_EXPRESSION_TYPE(E_FLOATLIT, FloatLit);
+LZN_EXPRESSION_TYPE(E_SETLIT, SetLit);
+LZN_EXPRESSION_TYPE(E_BOOLLIT, BoolLit);
+LZN_EXPRESSION_TYPE(E_STRINGLIT, StringLit);
+LZN_EXPRESSION_TYPE(E_ID, Id);
+LZN_EXPRESSION_TYPE(E_ANON, AnonVar);
+LZN_EXPRESSION_TYPE(E_ARRAYLIT, ArrayLit);
+LZN_EXPRESSION_TYPE(E_ARRAYACCESS, ArrayAccess);
+LZN_EXPRESSION_TYPE(E_COMP, Comprehension);
+LZN_EXPRESSION_TYPE(E_ITE, ITE);
+LZN_EXPRESSION_TYPE(E_BINOP, BinOp);
+LZN_EXPRESSION_TYPE(E_UNOP, UnOp);
+LZN_EXPRESSION_TYPE(E_CALL, Call);
+LZN_EXPRESSION_TYPE(E_VARDECL, VarDecl);
+LZN_EXPRESSION_TYPE(E_LET, Let);
+LZN_EXPRESSION_TYPE(E_TI, TypeInst);
+LZN_EXPRESSION_TYPE(E_TIID, TIId);
+#undef LZN_EXPRESSION_TYPE
+
+// What a `Target` of a pattern node matches, and the class of the matched expressions.
+template <auto Target>
+struct PatternTarget {
+  using T = decltype(Target);
+  static_assert(std::is_same_v<T, MiniZinc::Expression::ExpressionId> ||
+                    std::is_same_v<T, MiniZinc::BinOpType> || std::is_same_v<T, MiniZinc::UnOpType>,
+                "a target must be an ExpressionId, a BinOpType or an UnOpType");
+
+  static constexpr auto eid = [] {
+    if constexpr (std::is_same_v<T, MiniZinc::BinOpType>)
+      return MiniZinc::Expression::E_BINOP;
+    else if constexpr (std::is_same_v<T, MiniZinc::UnOpType>)
+      return MiniZinc::Expression::E_UNOP;
+    else
+      return Target;
+  }();
+  using type = typename ExpressionType<eid>::type;
+
+  static constexpr KindSet kinds = kind_bit(Target);
+
+  static bool match(const MiniZinc::Expression *e) {
+    if (e->eid() != eid)
+      return false;
+    if constexpr (std::is_same_v<T, MiniZinc::Expression::ExpressionId>)
+      return true;
+    else
+      return e->template cast<type>()->op() == Target;
+  }
+};
+
+template <typename Option>
+struct FilterOf {
+  static constexpr ExprFilterFun value = nullptr;
+};
+template <ExprFilterFun F>
+struct FilterOf<Filter<F>> {
+  static constexpr ExprFilterFun value = F;
+};
+
+// The properties of a node of a pattern.
+template <auto Target, bool Direct, typename... Options>
+struct PatternNode : PatternTarget<Target> {
+  static constexpr bool is_direct = Direct;
+  static constexpr bool captured = (std::is_same_v<Options, Capture> || ...);
+  static constexpr ExprFilterFun filter = [] {
+    ExprFilterFun f = nullptr;
+    ((f = f != nullptr ? f : FilterOf<Options>::value), ...);
+    return f;
+  }();
+
+  static bool run_filter(const MiniZinc::Expression *parent, const MiniZinc::Expression *child) {
+    if constexpr (filter != nullptr)
+      return filter(parent, child);
+    else
+      return true;
+  }
+};
+
+// The tuple of pointers to the captured nodes among `Nodes`.
+template <typename... Nodes>
+using PatternHit = decltype(std::tuple_cat(
+    std::declval<std::conditional_t<Nodes::captured, std::tuple<const typename Nodes::type *>,
+                                    std::tuple<>>>()...));
+
+// Searches for a pattern in a `FlatTree`. The candidates for an `under` node are scanned in
+// preorder, and only the nodes of the pattern are matched recursively. Subtrees that lack a kind
+// of the rest of the pattern are skipped.
+template <typename Globals, typename... Nodes>
+class PatternSearcher;
+
+template <ExprFilterFun... Fs, typename... Nodes>
+class PatternSearcher<GlobalFilters<Fs...>, Nodes...> {
+  using NodeList = std::tuple<Nodes...>;
+  template <std::size_t I>
+  using Node = std::tuple_element_t<I, NodeList>;
+  static constexpr std::size_t N = sizeof...(Nodes);
+  static_assert(N > 0, "a pattern needs at least one node");
+
+public:
+  using Hit = PatternHit<Nodes...>;
+
+private:
+  // Where the capture of node `I` is stored in `Hit`.
+  template <std::size_t I>
+  static constexpr std::size_t capture_slot() {
+    std::size_t slot = 0;
+    constexpr bool captured[] = {Nodes::captured...};
+    for (std::size_t i = 0; i < I; ++i) {
+      slot += captured[i] ? 1 : 0;
+    }
+    return slot;
+  }
+
+  // The kinds needed to match the nodes from `I` onwards.
+  template <std::size_t I>
+  static constexpr KindSet remaining_kinds() {
+    KindSet ks = 0;
+    constexpr KindSet kinds[] = {Nodes::kinds...};
+    for (std::size_t i = I; i < N; ++i) {
+      ks |= kinds[i];
+    }
+    return ks;
+  }
+
+  const FlatTree &tree;
+  std::size_t top;
+  Hit hit;
+
+public:
+  PatternSearcher(const FlatTree &tree, std::size_t top) : tree(tree), top(top) {}
+
+  template <typename F>
+  void search(F &f) {
+    candidates<0>(top, f);
+  }
+
+private:
+  bool run_global_filters(std::size_t parent, std::size_t child) const {
+    if constexpr (sizeof...(Fs) == 0) {
+      return true;
+    } else {
+      const MiniZinc::Expression *p = tree.expr(parent);
+      const MiniZinc::Expression *c = tree.expr(child);
+      return (Fs(p, c) && ...);
+    }
+  }
+
+  // Try to match node `I` at `first`, and at all its descendants if `I` is an `under` node. The
+  // edge from the parent of `first` is already filtered.
+  template <std::size_t I, typename F>
+  void candidates(std::size_t first, F &f) {
+    if constexpr (Node<I>::is_direct) {
+      match_at<I>(first, f);
+    } else {
+      const std::size_t end = tree.end(first);
+      for (std::size_t cur = first; cur < end;) {
+        if ((cur != first && !run_global_filters(tree.parent(cur), cur)) ||
+            !tree.may_contain(cur, remaining_kinds<I>())) {
+          cur = tree.end(cur);
+          continue;
+        }
+        match_at<I>(cur, f);
+        ++cur;
+      }
+    }
+  }
+
+  template <std::size_t I, typename F>
+  void match_at(std::size_t cur, F &f) {
+    using Target = Node<I>;
+    const MiniZinc::Expression *e = tree.expr(cur);
+    if (!Target::match(e))
+      return;
+    if constexpr (Target::is_direct) {
+      if (!tree.may_contain(cur, remaining_kinds<I>()))
+        return;
+    }
+    if constexpr (Target::captured)
+      std::get<capture_slot<I>()>(hit) = e->template cast<typename Target::type>();
+
+    if constexpr (I + 1 == N) {
+      f(static_cast<const Hit &>(hit), tree.path(cur, top));
+    } else {
+      tree.for_each_child(cur, [this, &f, e, cur](std::size_t child) {
+        if (run_global_filters(cur, child) && Target::run_filter(e, tree.expr(child)))
+          candidates<I + 1>(child, f);
+      });
+    }
+  }
+};
+
+template <typename... Nodes>
+struct PatternOf {
+  using searcher = PatternSearcher<GlobalFilters<>, Nodes...>;
+};
+template <ExprFilterFun... Fs, typename... Nodes>
+struct PatternOf<GlobalFilters<Fs...>, Nodes...> {
+  using searcher = PatternSearcher<GlobalFilters<Fs...>, Nodes...>;
+};
+
+} // namespace LZN::Impl
+
+namespace LZN {
+
+template <auto Target, typename... Options>
+struct Under : Impl::PatternNode<Target, false, Options...> {};
+template <auto Target, typename... Options>
+struct Direct : Impl::PatternNode<Target, true, Options...> {};
+
+// A search pattern, optionally starting with `GlobalFilters`, followed by at least one `Under` or
+// `Direct` node.
+template <typename... Args>
+class Pattern {
+  using Searcher = typename Impl::PatternOf<Args...>::searcher;
+
+public:
+  // A tuple with a pointer to each captured node, in order.
+  using Hit = typename Searcher::Hit;
+
+  // Call `f(hit, path)` for every hit in the subtree of `node`, where `path` is a pair of iterators
+  // over the path from the last node of the pattern up to `node`.
+  template <typename F>
+  static void search(const FlatTree &tree, std::size_t node, F f) {
+    assert(node < tree.size());
+    Searcher(tree, node).search(f);
+  }
+};
+
+} // namespace LZN
@@ -0,0 +1,174 @@
+#include <linter/overload.hpp>
+#include <linter/registry.hpp>
+#include <linter/result_io.hpp>
+#include <stdexcept>
+#include <variant>
+
+namespace {
+using namespace LZN;
+
+enum RegionTag : std::uint8_t { NO_REGION, ONE_LINE_MARKED, MULTI_LINE };
+
+// The rule with id `id`, nullptr if there is none.
+const LintRule *find_rule(lintId id) {
+  try {
+    return Registry::get(id);
+  } catch (const std::out_of_range &) {
+    return nullptr;
+  }
+}
+
+void write_contents(BinaryWriter &w, const FileContents &fc) {
+  w.str(fc.filename);
+  std::visit(overload{
+                 [&](const std::monostate &) { w.u8(NO_REGION); },
+                 [&](const FileContents::OneLineMarked &olm) {
+                   w.u8(ONE_LINE_MARKED);
+                   w.u32(olm.line);
+                   w.u32(olm.startcol);
+                   w.u8(olm.endcol.has_value());
+                   if (olm.endcol)
+                     w.u32(*olm.endcol);
+                 },
+                 [&](const FileContents::MultiLine &ml) {
+                   w.u8(MULTI_LINE);
+                   w.u32(ml.startline);
+                   w.u32(ml.endline);
+                 },
+             },
+             fc.region);
+}
+
+// The filename and the region of a `FileContents`, nullopt if the region is malformed.
+std::optional<std::pair<std::string, FileContents::Region>> read_contents(BinaryReader &r) {
+  std::string filename = r.str();
+  switch (r.u8()) {
+  case NO_REGION: return std::make_pair(std::move(filename), FileContents::Region());
+  case ONE_LINE_MARKED: {
+    const unsigned int line = r.u32();
+    const unsigned int startcol = r.u32();
+    FileContents::OneLineMarked olm(line, startcol);
+    if (r.u8() != 0)
+      olm.endcol = r.u32();
+    return std::make_pair(std::move(filename), FileContents::Region(olm));
+  }
+  case MULTI_LINE: {
+    const unsigned int startline = r.u32();
+    const unsigned int endline = r.u32();
+    return std::make_pair(std::move(filename),
+                          FileContents::Region(FileContents::MultiLine(startline, endline)));
+  }
+  default: return std::nullopt;
+  }
+}
+} // namespace
+
+namespace LZN {
+
+void BinaryWriter::u32(std::uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    u8(static_cast<std::uint8_t>(v >> (8 * i)));
+  }
+}
+
+void BinaryWriter::u64(std::uint64_t v) {
+  for (int i = 0; i < 8; ++i) {
+    u8(static_cast<std::uint8_t>(v >> (8 * i)));
+  }
+}
+
+void BinaryWriter::str(const std::string &s) {
+  u32(static_cast<std::uint32_t>(s.size()));
+  out += s;
+}
+
+bool BinaryReader::has(std::size_t n) {
+  if (!failed && in.size() - pos < n)
+    failed = true;
+  return !failed;
+}
+
+std::uint8_t BinaryReader::u8() {
+  if (!has(1))
+    return 0;
+  return static_cast<std::uint8_t>(in[pos++]);
+}
+
+std::uint32_t BinaryReader::u32() {
+  if (!has(4))
+    return 0;
+  std::uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) {
+    v |= static_cast<std::uint32_t>(u8()) << (8 * i);
+  }
+  return v;
+}
+
+std::uint64_t BinaryReader::u64() {
+  if (!has(8))
+    return 0;
+  std::uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) {
+    v |= static_cast<std::uint64_t>(u8()) << (8 * i);
+  }
+  return v;
+}
+
+std::string BinaryReader::str() {
+  const std::uint32_t size = u32();
+  if (!has(size))
+    return std::string();
+  std::string s = in.substr(pos, size);
+  pos += size;
+  return s;
+}
+
+void write_results(BinaryWriter &w, const std::vector<LintResult> &results) {
+  w.u32(static_cast<std::uint32_t>(results.size()));
+  for (const auto &res : results) {
+    w.u32(res.rule->id);
+    w.str(res.message);
+    write_contents(w, res.content);
+    w.u8(res.rewrite.has_value());
+    if (res.rewrite)
+      w.str(*res.rewrite);
+    w.u8(res.depends_on_instance);
+    w.u32(static_cast<std::uint32_t>(res.sub_results.size()));
+    for (const auto &sub : res.sub_results) {
+      w.str(sub.message);
+      write_contents(w, sub.content);
+    }
+  }
+}
+
+std::optional<std::vector<LintResult>> read_results(BinaryReader &r) {
+  std::vector<LintResult> results;
+  const std::uint32_t size = r.u32();
+  for (std::uint32_t i = 0; i < size && r.ok(); ++i) {
+    const LintRule *rule = find_rule(r.u32());
+    std::string message = r.str();
+    auto contents = read_contents(r);
+    if (rule == nullptr || !contents)
+      return std::nullopt;
+    auto &res = results.emplace_back(contents->second, contents->first.c_str(), rule,
+                                     std::move(message));
+    if (r.u8() != 0)
+      res.rewrite = r.str();
+    res.depends_on_instance = r.u8() != 0;
+
+    const std::uint32_t num_subs = r.u32();
+    for (std::uint32_t j = 0; j < num_subs && r.ok(); ++j) {
+      std::string sub_message = r.str();
+      auto sub_contents = read_contents(r);
+      if (!sub_contents)
+        return std::nullopt;
+      res.emplace_subresult(std::move(sub_message), sub_contents->second,
+                            sub_contents->first.c_str());
+    }
+  }
+  if (!r.ok())
+    return std::nullopt;
+  return results;
+}
+
+} // namespace LZN
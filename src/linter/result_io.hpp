@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <linter/rules.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace LZN {
+
+// Appends integers, in little endian, and length prefixed strings to a byte string.
+class BinaryWriter {
+  std::string &out;
+
+public:
+  explicit BinaryWriter(std::string &out) : out(out) {}
+
+  void u8(std::uint8_t v) { out.push_back(static_cast<char>(v)); }
+  void u32(std::uint32_t v);
+  void u64(std::uint64_t v);
+  void str(const std::string &s);
+};
+
+// Reads what a `BinaryWriter` wrote. Reading past the end, or a string longer than what is left,
+// fails the reader and returns zero or an empty string from then on.
+class BinaryReader {
+  const std::string &in;
+  std::size_t pos = 0;
+  bool failed = false;
+
+  // Returns true if `n` more bytes can be read, fails the reader otherwise.
+  bool has(std::size_t n);
+
+public:
+  explicit BinaryReader(const std::string &in) : in(in) {}
+
+  std::uint8_t u8();
+  std::uint32_t u32();
+  std::uint64_t u64();
+  std::string str();
+
+  // Returns true if nothing has failed so far.
+  bool ok() const noexcept { return !failed; }
+  // Returns true if everything is read.
+  bool at_end() const noexcept { return pos == in.size(); }
+};
+
+// Write `results` with everything in them: sub results, rewrites and whether they depend on the
+// instance. Rules are written as their ids.
+void write_results(BinaryWriter &w, const std::vector<LintResult> &results);
+// Read what `write_results` wrote, nullopt if it is malformed or refers to a rule that doesn't
+// exist in the `Registry`.
+std::optional<std::vector<LintResult>> read_results(BinaryReader &r);
+
+} // namespace LZN
@@ -1,18 +1,52 @@
 #include "rules.hpp"
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
 #include <linter/file_utils.hpp>
 #include <linter/overload.hpp>
 #include <linter/utils.hpp>
 #include <minizinc/hash.hh>
 #include <minizinc/prettyprinter.hh>
+#include <thread>
 
 namespace {
-template <typename T, typename F>
-const T &lazy_value(std::optional<T> &opt, F f) {
-  if (!opt) {
-    opt = f();
+// A function declared with var arguments generates a par version of the same function in the
+// exact same location. It doesn't seem like it is possible to use this new variant, so it is not
+// included. Both should be considered as the same function anyway.
+// TODO: double check that the correct one is being removed, is it always the second one?.
+bool is_duplicate_function(const std::vector<const MiniZinc::FunctionI *> &funcs,
+                           const MiniZinc::FunctionI *fi) {
+  return std::any_of(funcs.cbegin(), funcs.cend(), [fi](const MiniZinc::FunctionI *f) {
+    return f->id() == fi->id() && f->loc() == fi->loc();
+  });
+}
+
+// Add the declaration of the objective, _objective, unless already in `vec`.
+void add_objective(std::vector<const MiniZinc::VarDecl *> &vec, const MiniZinc::SolveI *si) {
+  if (si != nullptr && si->e() != nullptr) {
+    auto id = si->e()->dynamicCast<MiniZinc::Id>();
+    if (id != nullptr && id->decl() != nullptr &&
+        std::find(vec.begin(), vec.end(), id->decl()) == vec.end())
+      vec.push_back(id->decl());
   }
-  return *opt;
+}
+
+// Map every generator variable of `comp` to its generator.
+template <typename GenMap>
+void add_generators(GenMap &map, const MiniZinc::Comprehension *comp) {
+  for (unsigned int gen = 0; gen < comp->numberOfGenerators(); ++gen) {
+    for (unsigned int decl = 0; decl < comp->numberOfDecls(gen); ++decl) {
+      map.emplace(comp->decl(gen, decl), typename GenMap::mapped_type{comp, gen});
+    }
+  }
+}
+
+// Where `LintEnv::user_defined_variable_declarations` and the constraints in lets are searched for.
+LZN::Impl::SearchLocs declaration_locations() {
+  LZN::Impl::SearchLocs locs;
+  locs.use_vdi = locs.use_ai_rhs = locs.use_ci = locs.use_fi_body = true;
+  return locs;
 }
 } // namespace
 
@@ -76,19 +110,90 @@ bool FileContents::is_valid() const noexcept {
                     region);
 }
 
+thread_local std::vector<LintResult> *LintEnv::_rule_results = nullptr;
+
 void LintEnv::add_result(LintResult lr) {
-  _results.push_back(std::move(lr));
+  results_buffer().push_back(std::move(lr));
+}
+
+void LintEnv::run_rules(const std::vector<const LintRule *> &rules) {
+  if (_jobs <= 1) {
+    for (auto rule : rules) {
+      rule->run(*this);
+    }
+    return;
+  }
+
+  // every rule gets its own buffer, merged in the order of `rules` at the end
+  std::vector<std::vector<LintResult>> buffers(rules.size());
+  std::vector<std::size_t> concurrent, sequential;
+  for (std::size_t i = 0; i < rules.size(); ++i) {
+    (rules[i]->thread_safe ? concurrent : sequential).push_back(i);
+  }
+
+  std::atomic<std::size_t> next_rule = 0;
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto run_one = [&](std::size_t i) {
+    try {
+      _rule_results = &buffers[i];
+      rules[i]->run(*this);
+      _rule_results = nullptr;
+    } catch (...) {
+      _rule_results = nullptr;
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+  };
+  auto work = [&]() {
+    for (std::size_t i; (i = next_rule++) < concurrent.size();) {
+      run_one(concurrent[i]);
+    }
+  };
+
+  // the main thread runs the rules that aren't thread safe while the others run the rest
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < _jobs && i <= concurrent.size(); ++i) {
+    threads.emplace_back(work);
+  }
+  for (auto i : sequential) {
+    run_one(i);
+  }
+  work();
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (error)
+    std::rethrow_exception(error);
+
+  for (auto &buffer : buffers) {
+    std::move(buffer.begin(), buffer.end(), std::back_inserter(_results));
+  }
+}
+
+std::vector<LintResult> LintEnv::lint(const std::vector<const LintRule *> &rules) {
+  for (auto rule : rules) {
+    rule->prepare(*this);
+  }
+  perform_requested_searches();
+  run_rules(rules);
+  return take_results();
 }
 
 const LintEnv::ECMap &LintEnv::equal_constrained() {
-  return lazy_value(_equal_constrained, [this]() {
+  return _equal_constrained.get([this]() {
     LintEnv::ECMap ids;
+    auto inserter = [&ids](const MiniZinc::BinOp *eq, const MiniZinc::Id *id) {
+      auto other = other_side(eq, id);
+      assert(id->decl() != nullptr);
+      ids.emplace(id->decl(), other);
+    };
+    const auto &tree = flat_tree();
     for (auto con : constraints()) {
-      equal_constrained_variables(con, [&ids](const MiniZinc::BinOp *eq, const MiniZinc::Id *id) {
-        auto other = other_side(eq, id);
-        assert(id->decl() != nullptr);
-        ids.emplace(id->decl(), other);
-      });
+      const std::size_t node = tree.index_of(con);
+      assert(node != FlatTree::NONE); // every constraint is in the tree
+      equal_constrained_variables(tree, node, inserter);
     }
     return ids;
   });
@@ -96,7 +201,7 @@ const LintEnv::ECMap &LintEnv::equal_constrained() {
 
 const LintEnv::VDVec &LintEnv::user_defined_variable_declarations() {
   using ExpressionId = MiniZinc::Expression::ExpressionId;
-  return lazy_value(_vardecls, [this, model = _model]() {
+  return _vardecls.get([this]() {
     const auto s = userdef_only_builder()
                        .in_vardecl()
                        .in_assign_rhs()
@@ -105,7 +210,7 @@ const LintEnv::VDVec &LintEnv::user_defined_variable_declarations() {
                        .under(ExpressionId::E_VARDECL)
                        .capture()
                        .build();
-    auto ms = s.search(model);
+    auto ms = search_model(s);
 
     LintEnv::VDVec vec;
     while (ms.next()) {
@@ -123,52 +228,41 @@ const LintEnv::VDVec &LintEnv::user_defined_variable_declarations() {
       vec.push_back(vd);
     }
 
-    // add _objective
-    if (auto si = solve_item(); si != nullptr && si->e() != nullptr) {
-      auto id = si->e()->dynamicCast<MiniZinc::Id>();
-      if (id->decl() != nullptr && std::find(vec.begin(), vec.end(), id->decl()) == vec.end())
-        vec.push_back(id->decl());
-    }
-
+    add_objective(vec, solve_item());
     return vec;
   });
 }
 
 const LintEnv::AECMap &LintEnv::array_equal_constrained() {
-  return lazy_value(_array_equal_constrained, [this]() {
+  return _array_equal_constrained.get([this]() {
     LintEnv::AECMap map;
-
+    auto inserter = [&map](const MiniZinc::BinOp * /*eq*/, const MiniZinc::ArrayAccess *access,
+                           const MiniZinc::Id *id, const MiniZinc::Expression *rhs,
+                           const MiniZinc::Comprehension *comp) {
+      auto decl = id->decl();
+      assert(decl != nullptr);
+      map.emplace(std::piecewise_construct, std::forward_as_tuple(decl),
+                  std::forward_as_tuple(access, rhs, comp));
+    };
+    const auto &tree = flat_tree();
     for (auto con : constraints()) {
-      equal_constrained_access(con, [&map](const MiniZinc::BinOp * /*eq*/,
-                                           const MiniZinc::ArrayAccess *access,
-                                           const MiniZinc::Id *id, const MiniZinc::Expression *rhs,
-                                           const MiniZinc::Comprehension *comp) {
-        auto decl = id->decl();
-        assert(decl != nullptr);
-        map.emplace(std::piecewise_construct, std::forward_as_tuple(decl),
-                    std::forward_as_tuple(access, rhs, comp));
-      });
+      const std::size_t node = tree.index_of(con);
+      assert(node != FlatTree::NONE); // every constraint is in the tree
+      equal_constrained_access(tree, node, inserter);
     }
     return map;
   });
 }
 
 const LintEnv::UDFVec &LintEnv::user_defined_functions() {
-  return lazy_value(_user_defined_funcs, [this, model = _model]() {
+  return _user_defined_funcs.get([this, model = _model]() {
     const auto s = userdef_only_builder().in_function().build();
     auto ms = s.search(model);
     LintEnv::UDFVec vec;
     while (ms.next()) {
       auto fi = ms.cur_item()->cast<MiniZinc::FunctionI>();
-      // NOTE: A function declared with var arguments generats a par version of the same function in
-      // the exact same location. It doesn't seem like it is possible to use this new variant, so it
-      // is not included. Both should be considered as the same function anyway.
-      // TODO: double check that the correct one is being removed, is it always the second one?.
-      if (std::any_of(vec.cbegin(), vec.cend(), [fi](const MiniZinc::FunctionI *f) {
-            return f->id() == fi->id() && f->loc() == fi->loc();
-          }))
-        continue;
-      vec.push_back(fi);
+      if (!is_duplicate_function(vec, fi))
+        vec.push_back(fi);
     }
     return vec;
   });
@@ -176,7 +270,7 @@ const LintEnv::UDFVec &LintEnv::user_defined_functions() {
 
 const MiniZinc::SolveI *LintEnv::solve_item() {
   // TODO: why this instead of MiniZinc::Model::solveItem?
-  return lazy_value(_solve_item, [this, model = _model]() -> const MiniZinc::SolveI * {
+  return _solve_item.get([this, model = _model]() -> const MiniZinc::SolveI * {
     const auto s = userdef_only_builder().in_solve().build();
     auto ms = s.search(model);
     while (ms.next()) {
@@ -187,7 +281,7 @@ const MiniZinc::SolveI *LintEnv::solve_item() {
 }
 
 const LintEnv::VDSet &LintEnv::search_hinted_variables() {
-  return lazy_value(_search_hinted, [this]() {
+  return _search_hinted.get([this]() {
     LintEnv::VDSet set;
     auto solve = solve_item();
     if (solve == nullptr || solve->ann().isEmpty())
@@ -195,21 +289,32 @@ const LintEnv::VDSet &LintEnv::search_hinted_variables() {
 
     const auto s = userdef_only_builder().under(MiniZinc::Expression::E_ID).capture().build();
 
-    for (const auto *e : solve->ann()) {
-      auto ms = s.search(e);
-      while (ms.next()) {
-        auto id = ms.capture_cast<MiniZinc::Id>(0);
-        if (id->decl() != nullptr)
-          set.insert(id->decl());
-      }
+    auto ms = s.search(solve->ann().begin(), solve->ann().end());
+    while (ms.next()) {
+      auto id = ms.capture_cast<MiniZinc::Id>(0);
+      if (id->decl() != nullptr)
+        set.insert(id->decl());
     }
 
     return set;
   });
 }
 
+const IdSet &LintEnv::search_hinted_ids() {
+  return _search_hinted_ids.get([this]() {
+    const VDIds &ids = vardecl_ids();
+    IdSet set(ids.size());
+    for (auto vd : search_hinted_variables()) {
+      const std::size_t id = ids.id_of(vd);
+      if (id != VDIds::NONE)
+        set.insert(id);
+    }
+    return set;
+  });
+}
+
 const LintEnv::ExprVec &LintEnv::constraints() {
-  return lazy_value(_constraints, [this, model = _model]() {
+  return _constraints.get([this]() {
     LintEnv::ExprVec vec;
 
     { // constraints in let
@@ -221,7 +326,7 @@ const LintEnv::ExprVec &LintEnv::constraints() {
                          .under(MiniZinc::Expression::E_LET)
                          .capture()
                          .build();
-      auto ms = s.search(model);
+      auto ms = search_model(s);
 
       while (ms.next()) {
         auto let = ms.capture_cast<MiniZinc::Let>(0);
@@ -235,7 +340,7 @@ const LintEnv::ExprVec &LintEnv::constraints() {
 
     {
       const auto s = userdef_only_builder().in_constraint().build();
-      auto ms = s.search(model);
+      auto ms = search_model(s);
       while (ms.next()) {
         auto con = ms.cur_item()->cast<MiniZinc::ConstraintI>();
         vec.push_back(con->e());
@@ -247,7 +352,7 @@ const LintEnv::ExprVec &LintEnv::constraints() {
 }
 
 const LintEnv::CSet &LintEnv::comprehensions() {
-  return lazy_value(_comprehensions, [this, model = _model]() {
+  return _comprehensions.get([this]() {
     LintEnv::CSet set;
 
     const auto s = userdef_only_builder()
@@ -255,7 +360,7 @@ const LintEnv::CSet &LintEnv::comprehensions() {
                        .under(MiniZinc::Expression::E_COMP)
                        .capture()
                        .build();
-    auto ms = s.search(model);
+    auto ms = search_model(s);
 
     while (ms.next()) {
       auto comp = ms.capture_cast<MiniZinc::Comprehension>(0);
@@ -266,6 +371,131 @@ const LintEnv::CSet &LintEnv::comprehensions() {
   });
 }
 
+const LintEnv::GenMap &LintEnv::generators() {
+  return _generators.get([this]() {
+    GenMap map;
+    for (auto comp : comprehensions()) {
+      add_generators(map, comp);
+    }
+    return map;
+  });
+}
+
+void LintEnv::prepass() {
+  using ExpressionId = MiniZinc::Expression::ExpressionId;
+  const FlatTree &tree = flat_tree();
+  const Impl::SearchLocs decl_locs = declaration_locations();
+
+  UDFVec funcs;
+  const MiniZinc::SolveI *solve = nullptr;
+  VDVec vardecls;
+  ExprVec constraints, item_constraints;
+  CSet comps;
+  CIds comp_ids;
+  GenMap gens;
+
+  for (std::size_t it = 0; it < tree.num_items(); ++it) {
+    const MiniZinc::Item *item = tree.item(it);
+    bool duplicate = false;
+    if (auto fi = item->dynamicCast<MiniZinc::FunctionI>(); fi != nullptr) {
+      duplicate = is_duplicate_function(funcs, fi);
+      if (!duplicate)
+        funcs.push_back(fi);
+    } else if (auto si = item->dynamicCast<MiniZinc::SolveI>(); si != nullptr) {
+      if (solve == nullptr)
+        solve = si;
+    } else if (auto ci = item->dynamicCast<MiniZinc::ConstraintI>(); ci != nullptr) {
+      item_constraints.push_back(ci->e());
+    }
+
+    const bool in_decl_item = decl_locs.should_visit(item);
+    const auto [roots_begin, roots_end] = tree.item_roots(it);
+    for (auto root = roots_begin; root < roots_end; ++root) {
+      const auto loc = tree.root_location(root);
+      const bool in_decl_locs = in_decl_item && (loc == nullptr || decl_locs.*loc);
+      const std::size_t first = tree.root_node(root);
+      for (std::size_t node = first; node < tree.end(first); ++node) {
+        const MiniZinc::Expression *e = tree.expr(node);
+        switch (e->eid()) {
+        case ExpressionId::E_COMP:
+          comps.insert(e->cast<MiniZinc::Comprehension>());
+          comp_ids.add(e->cast<MiniZinc::Comprehension>());
+          add_generators(gens, e->cast<MiniZinc::Comprehension>());
+          break;
+        case ExpressionId::E_VARDECL:
+          if (in_decl_locs && !duplicate)
+            vardecls.push_back(e->cast<MiniZinc::VarDecl>());
+          break;
+        case ExpressionId::E_LET:
+          if (!in_decl_locs)
+            break;
+          for (auto constr : e->cast<MiniZinc::Let>()->let()) {
+            if (constr->eid() != ExpressionId::E_VARDECL)
+              constraints.push_back(constr);
+          }
+          break;
+        default: break;
+        }
+      }
+    }
+  }
+  add_objective(vardecls, solve);
+  constraints.insert(constraints.end(), item_constraints.begin(), item_constraints.end());
+
+  _function_ids.set(UDFIds(funcs.begin(), funcs.end()));
+  _vardecl_ids.set(VDIds(vardecls.begin(), vardecls.end()));
+  _user_defined_funcs.set(std::move(funcs));
+  _solve_item.set(solve);
+  _vardecls.set(std::move(vardecls));
+  _constraints.set(std::move(constraints));
+  _comprehensions.set(std::move(comps));
+  _comprehension_ids.set(std::move(comp_ids));
+  _generators.set(std::move(gens));
+  search_hinted_ids();
+}
+
+const FlatTree &LintEnv::flat_tree() {
+  return _flat_tree.get([this, model = _model]() {
+    return FlatTree(model, userdef_only_builder().build());
+  });
+}
+
+const NodeIndex &LintEnv::node_index() {
+  return _node_index.get([this]() { return NodeIndex(flat_tree()); });
+}
+
+const DefUseIndex &LintEnv::def_use() {
+  return _def_use.get([this]() {
+    return DefUseIndex(flat_tree(), user_defined_functions(), user_defined_variable_declarations());
+  });
+}
+
+const LintEnv::VDIds &LintEnv::vardecl_ids() {
+  return _vardecl_ids.get([this]() {
+    const auto &vardecls = user_defined_variable_declarations();
+    return VDIds(vardecls.begin(), vardecls.end());
+  });
+}
+
+const LintEnv::UDFIds &LintEnv::function_ids() {
+  return _function_ids.get([this]() {
+    const auto &funcs = user_defined_functions();
+    return UDFIds(funcs.begin(), funcs.end());
+  });
+}
+
+const LintEnv::CIds &LintEnv::comprehension_ids() {
+  return _comprehension_ids.get([this]() {
+    const FlatTree &tree = flat_tree();
+    CIds ids;
+    for (std::size_t node = 0; node < tree.size(); ++node) {
+      if (auto comp = tree.expr(node)->dynamicCast<MiniZinc::Comprehension>(); comp != nullptr)
+        ids.add(comp);
+    }
+    return ids;
+  });
+}
+
 const MiniZinc::Expression *LintEnv::get_equal_constrained_rhs(const MiniZinc::VarDecl *vd) {
   const auto &map = equal_constrained();
   auto it = map.find(vd);
@@ -276,35 +506,225 @@ const MiniZinc::Expression *LintEnv::get_equal_constrained_rhs(const MiniZinc::V
   return nullptr;
 }
 
+const LintEnv::ArrayCoverage *LintEnv::array_coverage(const MiniZinc::VarDecl *arraydecl) {
+  const auto &map = _array_coverage.get([this]() {
+    CoverageMap map;
+    for (const auto &[decl, value] : array_equal_constrained()) {
+      ArrayCoverage &coverage = map[decl];
+      coverage.accesses.push_back(&value);
+      const auto [arrayaccess, rhs, comp] = value;
+      if (comp == nullptr)
+        continue;
+
+      if (!is_array_access_simple(arrayaccess) ||
+          !comprehension_satisfies_array_access(comp, arrayaccess) ||
+          comprehension_contains_where(comp))
+        continue;
+
+      if (comprehension_covers_whole_array(comp, decl))
+        coverage.covering.push_back(comp);
+    }
+    return map;
+  });
+  auto it = map.find(arraydecl);
+  return it != map.end() ? &it->second : nullptr;
+}
+
 bool LintEnv::is_every_index_touched(const MiniZinc::VarDecl *arraydecl) {
-  auto [first, last] = array_equal_constrained().equal_range(arraydecl);
-  if (first == last)
+  const ArrayCoverage *coverage = array_coverage(arraydecl);
+  return coverage != nullptr && coverage->covered();
+}
+
+const LintEnv::Generator *LintEnv::generator_of(const MiniZinc::VarDecl *vd) {
+  const auto &map = generators();
+  auto it = map.find(vd);
+  return it != map.end() ? &it->second : nullptr;
+}
+
+bool LintEnv::depends_on_instance(const MiniZinc::Expression *e) {
+  if (e == nullptr)
     return false;
+  std::lock_guard<std::mutex> lock(_dependence_mutex);
+  if (auto it = _expr_dependence.find(e); it != _expr_dependence.end())
+    return it->second;
 
-  for (; first != last; ++first) {
-    auto [arrayaccess, rhs, comp] = first->second;
-    if (comp == nullptr)
-      continue;
+  std::vector<const MiniZinc::VarDecl *> decls;
+  referenced_vardecls(e, decls);
+  const bool dependent = std::any_of(decls.begin(), decls.end(), [this](auto vd) {
+    return vardecl_depends_on_instance(vd);
+  });
+  _expr_dependence.emplace(e, dependent);
+  return dependent;
+}
 
-    if (!is_array_access_simple(arrayaccess) ||
-        !comprehension_satisfies_array_access(comp, arrayaccess) ||
-        comprehension_contains_where(comp))
-      continue;
+void LintEnv::referenced_vardecls(const MiniZinc::Expression *e,
+                                  std::vector<const MiniZinc::VarDecl *> &decls) {
+  if (e == nullptr)
+    return;
+  auto scan = [&decls](const FlatTree &tree, std::size_t node) {
+    const std::size_t end = tree.end(node);
+    for (std::size_t cur = node; cur < end;) {
+      if (!tree.may_contain(cur, Impl::kind_bit(MiniZinc::Expression::E_ID))) {
+        cur = tree.end(cur);
+        continue;
+      }
+      if (auto id = tree.expr(cur)->dynamicCast<MiniZinc::Id>(); id != nullptr && id->decl())
+        decls.push_back(id->decl());
+      ++cur;
+    }
+  };
+  const FlatTree &tree = flat_tree();
+  if (const std::size_t node = tree.index_of(e); node != FlatTree::NONE) {
+    scan(tree, node);
+  } else {
+    scan(FlatTree(e), 0);
+  }
+}
 
-    if (comprehension_covers_whole_array(comp, arraydecl))
-      return true;
+// An explicit worklist instead of recursion, as chains of declarations can be long. A declaration
+// depends on the instance if it is a top-level parameter, or if anything its domain, right hand
+// side or generator refers to does. Array accesses and let-bound parameters are covered by the
+// right hand sides. Cycles, which the type checker should reject anyway, are broken by assuming
+// that a declaration that is being visited doesn't depend on the instance.
+bool LintEnv::vardecl_depends_on_instance(const MiniZinc::VarDecl *root) {
+  struct Frame {
+    const MiniZinc::VarDecl *vd;
+    std::vector<const MiniZinc::VarDecl *> refs;
+    std::size_t next;
+  };
+  std::vector<Frame> stack;
+  auto visit = [&](const MiniZinc::VarDecl *vd) {
+    auto [it, inserted] = _decl_dependence.emplace(vd, Dependence::visiting);
+    if (!inserted)
+      return;
+    if (vd->type().isPar() && vd->toplevel()) {
+      it->second = Dependence::dependent;
+      return;
+    }
+    Frame f{vd, {}, 0};
+    referenced_vardecls(vd->ti()->domain(), f.refs);
+    referenced_vardecls(vd->e(), f.refs);
+    if (auto gen = generator_of(vd); gen != nullptr)
+      referenced_vardecls(gen->comp->in(gen->gen), f.refs);
+    stack.push_back(std::move(f));
+  };
+
+  visit(root);
+  while (!stack.empty()) {
+    Frame &f = stack.back();
+    if (f.next == f.refs.size()) {
+      _decl_dependence[f.vd] = Dependence::independent;
+      stack.pop_back();
+      continue;
+    }
+    const MiniZinc::VarDecl *ref = f.refs[f.next];
+    auto it = _decl_dependence.find(ref);
+    if (it == _decl_dependence.end()) {
+      visit(ref); // `f` is checked again once `ref` is decided
+    } else if (it->second == Dependence::dependent) {
+      _decl_dependence[f.vd] = Dependence::dependent;
+      stack.pop_back();
+    } else {
+      ++f.next;
+    }
   }
-  return false;
+  return _decl_dependence[root] == Dependence::dependent;
+}
+
+IntInterval LintEnv::int_bounds(const MiniZinc::Expression *e) {
+  std::lock_guard<std::mutex> lock(_bounds_mutex);
+  return _bounds.bounds(e);
 }
 
 bool LintEnv::is_search_hinted(const MiniZinc::VarDecl *vd) {
-  return search_hinted_variables().count(vd) > 0;
+  const std::size_t id = vardecl_ids().id_of(vd);
+  if (id == VDIds::NONE)
+    return search_hinted_variables().count(vd) > 0;
+  return search_hinted_ids().contains(id);
 }
 
 SearchBuilder LintEnv::userdef_only_builder() const {
   return SearchBuilder().only_user_defined(_includePath).recursive();
 }
 
+void LintEnv::request_search(Search s) {
+  std::lock_guard<std::mutex> lock(_search_mutex);
+  _requested_searches.push_back(std::move(s));
+}
+
+void LintEnv::perform_requested_searches() {
+  std::lock_guard<std::mutex> lock(_search_mutex);
+  MultiSearch multi;
+  std::vector<const Search *> added;
+  for (const auto &s : _requested_searches) {
+    auto is_s = [&s](const auto *other) { return *other == s; };
+    if (std::any_of(added.begin(), added.end(), is_s)) {
+      ++_search_stats.hits;
+      continue;
+    }
+    if (cached_search(s) != nullptr)
+      continue;
+    ++_search_stats.misses;
+    if (search_node_index(s) != nullptr)
+      continue;
+    if (!flat_tree().same_scope(s)) {
+      search_tree(s);
+      continue;
+    }
+    multi.add(s);
+    added.push_back(&s);
+  }
+  if (added.empty()) {
+    _requested_searches.clear();
+    return;
+  }
+
+  auto hits = multi.search_parallel(flat_tree(), _jobs);
+  for (std::size_t i = 0; i < added.size(); ++i) {
+    _searched.emplace(*added[i], std::move(hits[i]));
+  }
+  _requested_searches.clear();
+}
+
+Search::HitsSearcher LintEnv::search_model(const Search &s) {
+  std::lock_guard<std::mutex> lock(_search_mutex);
+  if (auto hits = cached_search(s); hits != nullptr)
+    return Search::HitsSearcher(*hits);
+  ++_search_stats.misses;
+  if (auto hits = search_node_index(s); hits != nullptr)
+    return Search::HitsSearcher(*hits);
+  return Search::HitsSearcher(search_tree(s));
+}
+
+const SearchHits *LintEnv::cached_search(const Search &s) {
+  auto it = _searched.find(s);
+  if (it == _searched.end())
+    return nullptr;
+  ++_search_stats.hits;
+  return &it->second;
+}
+
+const SearchHits *LintEnv::search_node_index(const Search &s) {
+  // don't build the index for searches it can never answer
+  if (!NodeIndex::is_single_node(s) || !node_index().can_answer(s))
+    return nullptr;
+  return &_searched.emplace(s, node_index().hits(s)).first->second;
+}
+
+const SearchHits &LintEnv::search_tree(const Search &s) {
+  const FlatTree *tree = &flat_tree();
+  if (!tree->same_scope(s)) {
+    auto other = std::find_if(_other_trees.begin(), _other_trees.end(),
+                              [&s](const FlatTree &t) { return t.same_scope(s); });
+    tree = other != _other_trees.end() ? &*other : &_other_trees.emplace_back(_model, s);
+  }
+
+  MultiSearch multi;
+  multi.add(s);
+  return _searched.emplace(s, std::move(multi.search_parallel(*tree, _jobs).front()))
+      .first->second;
+}
+
 void LintResult::set_rewrite(const MiniZinc::Expression *expr) {
   std::ostringstream oss;
   MiniZinc::Printer p(oss, 0, false);
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <linter/bounds.hpp>
+#include <linter/def_use.hpp>
+#include <linter/dense_ids.hpp>
 #include <linter/searcher.hpp>
 #include <minizinc/model.hh>
+#include <deque>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <tuple>
@@ -13,6 +18,7 @@ namespace LZN {
 
 // forward declare
 struct LintResult;
+class LintRule;
 
 // type used for the ids of LintRules.
 using lintId = unsigned int;
@@ -30,24 +36,56 @@ enum class Category {
 inline const std::vector<std::string> CATEGORY_NAMES = {"challenge", "style", "unsure",
                                                         "performance", "redundant"};
 
+// What the results of a lint rule depend on.
+enum class RuleScope {
+  MODEL, // Anything in the model.
+  ITEM,  // Only the top-level item a result is in and the declarations it refers to, at any
+         // depth. Every result, and its sub results, are within that item.
+};
+
+// A value that is computed on first use. It is computed only once, even if several threads ask for
+// it at the same time.
+template <typename T>
+class Lazy {
+  std::once_flag flag;
+  std::optional<T> value;
+
+public:
+  // The value, computed with `f` if this is the first use.
+  template <typename F>
+  const T &get(F f) {
+    std::call_once(flag, [&]() { value.emplace(f()); });
+    return *value;
+  }
+  // Set the value, unless it is already computed.
+  void set(T v) {
+    std::call_once(flag, [&]() { value.emplace(std::move(v)); });
+  }
+};
+
 // Environment where rules get their information and where they store their information.
-// Some commonly performed searches are cached here as well.
+// Some commonly performed searches are cached here as well. The rules can be run concurrently, see
+// `run_rules`, so everything a rule can reach from here is safe to use from several threads.
 class LintEnv {
   // The parsed model to lint
   const MiniZinc::Model *_model;
   MiniZinc::Env &_env;
   // A vector of all results
   std::vector<LintResult> _results;
+  // The results of the rule this thread is running in `run_rules`, nullptr means `_results`.
+  static thread_local std::vector<LintResult> *_rule_results;
   // The include path
   const std::vector<std::string> &_includePath;
+  // The number of threads model searches and rules may use
+  unsigned int _jobs;
 
   // Looks anywhere for constraints on the form: constraint Id = Expr;
   using ECMap = std::unordered_map<const MiniZinc::VarDecl *, const MiniZinc::Expression *>;
-  std::optional<ECMap> _equal_constrained;
+  Lazy<ECMap> _equal_constrained;
 
   // Looks everywhere for all variable and parameter declarations.
   using VDVec = std::vector<const MiniZinc::VarDecl *>;
-  std::optional<VDVec> _vardecls;
+  Lazy<VDVec> _vardecls;
 
   // Looks anywhere for constrains on the form: constraint forall([Id[Expr] = Expr | ... ]); and
   // constraint Id[Expr] = Expr;
@@ -60,39 +98,125 @@ class LintEnv {
         : arrayaccess(arrayaccess), rhs(rhs), comp(comp) {}
   };
   using AECMap = std::unordered_multimap<const MiniZinc::VarDecl *, AECValue>;
-  std::optional<AECMap> _array_equal_constrained;
+  Lazy<AECMap> _array_equal_constrained;
+
+public:
+  // How an array is constrained by `array_equal_constrained`, see `array_coverage`.
+  struct ArrayCoverage {
+    std::vector<const AECValue *> accesses; // every entry of the array, in no particular order
+    std::vector<const MiniZinc::Comprehension *> covering; // comprehensions over every index
+    bool covered() const noexcept { return !covering.empty(); }
+  };
+
+private:
+  using CoverageMap = std::unordered_map<const MiniZinc::VarDecl *, ArrayCoverage>;
+  Lazy<CoverageMap> _array_coverage;
 
   // functions not from stdlib nor auto generated (enums)
   using UDFVec = std::vector<const MiniZinc::FunctionI *>;
-  std::optional<UDFVec> _user_defined_funcs;
+  Lazy<UDFVec> _user_defined_funcs;
 
   // the one and only solve item
-  std::optional<const MiniZinc::SolveI *> _solve_item;
+  Lazy<const MiniZinc::SolveI *> _solve_item;
 
   // constraints inside let
   using ExprVec = std::vector<const MiniZinc::Expression *>;
-  std::optional<ExprVec> _constraints;
+  Lazy<ExprVec> _constraints;
 
   // variables that are present in the search annotation
   using VDSet = std::unordered_set<const MiniZinc::VarDecl *>;
-  std::optional<VDSet> _search_hinted;
+  Lazy<VDSet> _search_hinted;
 
   // all comprehensions
   using CSet = std::unordered_set<const MiniZinc::Comprehension *>;
-  std::optional<CSet> _comprehensions;
+  Lazy<CSet> _comprehensions;
+
+  // the comprehension and generator every generator variable of `_comprehensions` belongs to
+  struct Generator {
+    const MiniZinc::Comprehension *comp;
+    unsigned int gen;
+  };
+  using GenMap = std::unordered_map<const MiniZinc::VarDecl *, Generator>;
+  Lazy<GenMap> _generators;
+
+  // dense ids of the user defined variable declarations and functions, in the same order as
+  // above, and of all comprehensions, in preorder
+  using VDIds = DenseIds<MiniZinc::VarDecl>;
+  Lazy<VDIds> _vardecl_ids;
+  using UDFIds = DenseIds<MiniZinc::FunctionI>;
+  Lazy<UDFIds> _function_ids;
+  using CIds = DenseIds<MiniZinc::Comprehension>;
+  Lazy<CIds> _comprehension_ids;
+
+  // the ids in `_vardecl_ids` of the variables in `_search_hinted`
+  Lazy<IdSet> _search_hinted_ids;
+
+  // whether declarations and expressions depend on top-level parameters, see
+  // `depends_on_instance`
+  enum class Dependence { visiting, independent, dependent };
+  std::unordered_map<const MiniZinc::VarDecl *, Dependence> _decl_dependence;
+  std::unordered_map<const MiniZinc::Expression *, bool> _expr_dependence;
+  std::mutex _dependence_mutex;
+
+  // the bounds of integer expressions, see `int_bounds`
+  IntBoundsAnalysis _bounds;
+  std::mutex _bounds_mutex;
+
+  // every user defined expression, flattened
+  Lazy<FlatTree> _flat_tree;
+
+  // every user defined expression, grouped by kind
+  Lazy<NodeIndex> _node_index;
+
+  // which user defined functions and variable declarations use which
+  Lazy<DefUseIndex> _def_use;
+
+  // trees for searches that don't have the same scope as `_flat_tree`
+  std::deque<FlatTree> _other_trees;
+
+  // Model searches requested by rules before they are run, see `LintRule::prepare`.
+  std::vector<Search> _requested_searches;
+  // The hits of every performed model search.
+  std::unordered_map<Search, SearchHits> _searched;
+  // Guards `_requested_searches`, `_searched`, `_other_trees` and `_search_stats`.
+  std::mutex _search_mutex;
+
+public:
+  // How many model searches were answered by the hits of an earlier equal search, and how many
+  // had to be performed.
+  struct SearchStats {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+  };
+
+private:
+  SearchStats _search_stats;
 
 public:
   LintEnv(const MiniZinc::Model *model, MiniZinc::Env &env,
-          const std::vector<std::string> &includePath)
-      : _model(model), _env(env), _includePath(includePath) {}
+          const std::vector<std::string> &includePath, unsigned int jobs = 1)
+      : _model(model), _env(env), _includePath(includePath), _jobs(jobs),
+        _bounds([this](const MiniZinc::VarDecl *vd) -> const MiniZinc::Expression * {
+          auto gen = generator_of(vd);
+          return gen != nullptr ? gen->comp->in(gen->gen) : nullptr;
+        }) {}
+  // the cached searches refer to each other
+  LintEnv(const LintEnv &) = delete;
+  LintEnv &operator=(const LintEnv &) = delete;
 
   // Add a LintResult, can be constructed in-place.
   template <typename... Args>
   decltype(_results)::reference emplace_result(Args &&...args) {
-    return _results.emplace_back(std::forward<Args>(args)...);
+    return results_buffer().emplace_back(std::forward<Args>(args)...);
   }
   void add_result(LintResult lr);
 
+  // Run all `rules`, the ones that are thread safe on up to `jobs` threads as given to the
+  // constructor. The results are in the same order as if the rules were run one after another.
+  void run_rules(const std::vector<const LintRule *> &rules);
+  // Prepare `rules`, perform the searches they request, run them and take all results.
+  std::vector<LintResult> lint(const std::vector<const LintRule *> &rules);
+
   // return a reference to all results.
   const std::vector<LintResult> &results() & { return _results; }
   // take all results
@@ -100,6 +224,15 @@ public:
   // pointer to the model
   const MiniZinc::Model *model() const { return _model; }
   MiniZinc::Env &minizinc_env() { return _env; }
+  const std::vector<std::string> &include_path() const noexcept { return _includePath; }
+  unsigned int jobs() const noexcept { return _jobs; }
+
+  // Fill the caches of `user_defined_functions`, `solve_item`,
+  // `user_defined_variable_declarations`, `constraints`, `comprehensions`, `generators`,
+  // `search_hinted_variables` and the dense ids in a single walk over `flat_tree`, instead of
+  // searching the model once for each of them when they are first used. Optional, the results are
+  // the same.
+  void prepass();
 
   // Cached searches, each one explained above.
   const ECMap &equal_constrained();
@@ -108,36 +241,92 @@ public:
   const UDFVec &user_defined_functions();
   const MiniZinc::SolveI *solve_item();
   const VDSet &search_hinted_variables();
+  const IdSet &search_hinted_ids();
   const ExprVec &constraints();
   const CSet &comprehensions();
+  const GenMap &generators();
+  const FlatTree &flat_tree();
+  const NodeIndex &node_index();
+  const DefUseIndex &def_use();
+  const VDIds &vardecl_ids();
+  const UDFIds &function_ids();
+  const CIds &comprehension_ids();
 
   // return what the variable is equal constrained to
   const MiniZinc::Expression *get_equal_constrained_rhs(const MiniZinc::VarDecl *);
+  // How `array_equal_constrained` constrains `arraydecl`, nullptr if it doesn't.
+  const ArrayCoverage *array_coverage(const MiniZinc::VarDecl *arraydecl);
   // is every index in the array touched from constraints?
   bool is_every_index_touched(const MiniZinc::VarDecl *);
+  // the generator `vd` is a variable of, or nullptr if it isn't a generator variable
+  const Generator *generator_of(const MiniZinc::VarDecl *vd);
+  // Check if `e` depends on top-level parameters, directly or through the domain, the right hand
+  // side or the generator of any declaration it refers to. The answers are cached.
+  bool depends_on_instance(const MiniZinc::Expression *e);
+  // The bounds of `e`, or of its elements if it is a set or an array, see `IntBoundsAnalysis`.
+  IntInterval int_bounds(const MiniZinc::Expression *e);
   // check whether a variable is mentioned in the search hint
   bool is_search_hinted(const MiniZinc::VarDecl *);
 
   // return a builder that filters out everything (functions and includes) that is not user defined.
   SearchBuilder userdef_only_builder() const;
+
+  // Request a model search to be performed later, together with all other requested searches, in
+  // a single traversal of the model.
+  void request_search(Search s);
+  // Perform all requested searches, using up to `jobs` threads as given to the constructor.
+  void perform_requested_searches();
+  // Search the model. The hits are taken from a previous search if an equal search was already
+  // performed, for example by `perform_requested_searches`, or from `node_index` if possible.
+  Search::HitsSearcher search_model(const Search &s);
+  const SearchStats &search_stats() const noexcept { return _search_stats; }
+
+private:
+  std::vector<LintResult> &results_buffer() {
+    return _rule_results != nullptr ? *_rule_results : _results;
+  }
+  // The stored hits of `s`, or nullptr if it hasn't been performed yet.
+  const SearchHits *cached_search(const Search &s);
+  // Store the hits of `s` from `node_index` and return them, or nullptr if the index can't answer
+  // `s`.
+  const SearchHits *search_node_index(const Search &s);
+  // Search a tree with the same scope as `s`, and store and return the hits.
+  const SearchHits &search_tree(const Search &s);
+  // The declarations of the ids in `e`, added to `decls`.
+  void referenced_vardecls(const MiniZinc::Expression *e,
+                           std::vector<const MiniZinc::VarDecl *> &decls);
+  // Whether `vd` depends on top-level parameters, `_dependence_mutex` must be held.
+  bool vardecl_depends_on_instance(const MiniZinc::VarDecl *vd);
 };
 
 // A lint rule. Contains necessary metadata and a function to perform analysis.
 class LintRule {
 protected:
-  constexpr LintRule(lintId id, const char *name, Category cat)
-      : id(id), name(name), category(cat) {}
+  constexpr LintRule(lintId id, const char *name, Category cat, bool thread_safe = false,
+                     RuleScope scope = RuleScope::MODEL)
+      : id(id), name(name), category(cat), thread_safe(thread_safe), scope(scope) {}
   ~LintRule() = default;
 
 public:
   const lintId id;         // an id that must be unique
   const char *const name;  // a unique printable name
   const Category category; // a category a rule fits in to
-
+  // Whether `run` can be called at the same time as other rules, in another thread. A rule that
+  // allocates anything owned by the MiniZinc garbage collector, such as expressions for rewrites
+  // or ASTStrings, is not thread safe. Such rules are run one at a time in the main thread. A rule
+  // is only run concurrently if it says so.
+  const bool thread_safe;
+  // What the results depend on. A rule with `RuleScope::ITEM` finds the same things in an item no
+  // matter what else is in the model, so it can be run on only the items that have changed.
+  const RuleScope scope;
+
+  // Request the model searches the analysis is going to perform, see `LintEnv::request_search`.
+  void prepare(LintEnv &env) const { do_prepare(env); }
   // Perform the analysis
   void run(LintEnv &env) const { do_run(env); }
 
 private:
+  virtual void do_prepare(LintEnv &) const {}
   virtual void do_run(LintEnv &env) const = 0;
 };
 
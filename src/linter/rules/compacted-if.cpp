@@ -7,17 +7,23 @@ using namespace LZN;
 
 class CompactedIf : public LintRule {
 public:
-  constexpr CompactedIf() : LintRule(20, "compacted-if", Category::PERFORMANCE) {}
+  constexpr CompactedIf()
+      : LintRule(20, "compacted-if", Category::PERFORMANCE, /*thread_safe=*/false,
+                 RuleScope::ITEM) {}
 
 private:
   using ExpressionId = MiniZinc::Expression::ExpressionId;
   using BT = MiniZinc::BinOpType;
   using UT = MiniZinc::UnOpType;
 
+  static Search ite_search(const LintEnv &env) {
+    return env.userdef_only_builder().in_everywhere().under(ExpressionId::E_ITE).capture().build();
+  }
+
+  virtual void do_prepare(LintEnv &env) const override { env.request_search(ite_search(env)); }
+
   virtual void do_run(LintEnv &env) const override {
-    const auto s =
-        env.userdef_only_builder().in_everywhere().under(ExpressionId::E_ITE).capture().build();
-    auto ms = s.search(env.model());
+    auto ms = env.search_model(ite_search(env));
 
     while (ms.next()) {
       auto ite = ms.capture_cast<MiniZinc::ITE>(0);
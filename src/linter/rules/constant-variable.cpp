@@ -7,7 +7,8 @@ using namespace LZN;
 
 class ConstantVariable : public LintRule {
 public:
-  constexpr ConstantVariable() : LintRule(4, "constant-variable", Category::REDUNDANT) {}
+  constexpr ConstantVariable()
+      : LintRule(4, "constant-variable", Category::REDUNDANT, /*thread_safe=*/true) {}
 
 private:
   using ExpressionId = MiniZinc::Expression::ExpressionId;
@@ -28,9 +29,9 @@ private:
 
       } else if (rhs == nullptr && vd->ti()->isarray() && env.is_every_index_touched(vd)) {
         std::vector<const MiniZinc::Location *> sub_locations;
-        auto [first, last] = env.array_equal_constrained().equal_range(vd);
-        bool all_par = std::all_of(first, last, [&sub_locations](auto &pair) {
-          auto [arrayaccess, rhs, comp] = pair.second;
+        const auto &accesses = env.array_coverage(vd)->accesses;
+        bool all_par = std::all_of(accesses.begin(), accesses.end(), [&sub_locations](auto value) {
+          auto [arrayaccess, rhs, comp] = *value;
           sub_locations.push_back(&arrayaccess->loc());
           return rhs->type().isPar();
         });
@@ -6,20 +6,29 @@ using namespace LZN;
 
 class ElementPredicate : public LintRule {
 public:
-  constexpr ElementPredicate() : LintRule(15, "element-predicate", Category::STYLE) {}
+  constexpr ElementPredicate()
+      : LintRule(15, "element-predicate", Category::STYLE, /*thread_safe=*/false,
+                 RuleScope::ITEM) {}
 
 private:
-  using ExpressionId = MiniZinc::Expression::ExpressionId;
   using BT = MiniZinc::BinOpType;
 
+  static Search call_search(const LintEnv &env) {
+    return env.userdef_only_builder()
+        .in_everywhere()
+        .under(MiniZinc::constants().ids.element)
+        .capture()
+        .build();
+  }
+
+  virtual void do_prepare(LintEnv &env) const override { env.request_search(call_search(env)); }
+
   virtual void do_run(LintEnv &env) const override {
-    const auto s =
-        env.userdef_only_builder().in_everywhere().under(ExpressionId::E_CALL).capture().build();
-    auto ms = s.search(env.model());
+    auto ms = env.search_model(call_search(env));
 
     while (ms.next()) {
       auto call = ms.capture_cast<MiniZinc::Call>(0);
-      if (call->id() == MiniZinc::constants().ids.element && call->argCount() == 3) {
+      if (call->argCount() == 3) {
         MiniZinc::GCLock lock;
         auto arracc = new MiniZinc::ArrayAccess(MiniZinc::Location().introduce(), call->arg(1),
                                                 {call->arg(0)});
@@ -1,127 +1,202 @@
+#include <cstring>
 #include <linter/registry.hpp>
 #include <linter/rules.hpp>
 #include <linter/utils.hpp>
+#include <optional>
+#include <unordered_map>
 
 namespace {
 using namespace LZN;
 
 class NonFuncHint : public LintRule {
 public:
-  constexpr NonFuncHint() : LintRule(9, "non-func-hint", Category::CHALLENGE) {}
+  constexpr NonFuncHint()
+      : LintRule(9, "non-func-hint", Category::CHALLENGE, /*thread_safe=*/true) {}
 
 private:
   using ExpressionId = MiniZinc::Expression::ExpressionId;
 
-  using VDSet = std::unordered_set<const MiniZinc::VarDecl *>;
-  using Vis = std::unordered_set<const MiniZinc::FunctionI *>;
+  // A call in a conjunctive context of a function body, passing parameter `param` of the function
+  // as argument `arg` of the call to `callee`.
+  struct PassedParam {
+    const MiniZinc::FunctionI *callee;
+    unsigned int arg;
+    unsigned int param;
+  };
+  // Which parameters of a function it defines functionally, itself or through the functions it
+  // calls.
+  struct Summary {
+    std::vector<bool> defines;
+    std::vector<PassedParam> passed;
+  };
+  using Summaries = std::unordered_map<const MiniZinc::FunctionI *, Summary>;
+
+  static Search call_search(const LintEnv &env) {
+    return env.userdef_only_builder().in_constraint().under(ExpressionId::E_CALL).capture().build();
+  }
+
+  virtual void do_prepare(LintEnv &env) const override { env.request_search(call_search(env)); }
 
   virtual void do_run(LintEnv &env) const override {
-    VDSet non_func;
-    for (auto vd : env.user_defined_variable_declarations()) {
-      if (vd->e() == nullptr && vd->toplevel() && vd->type().isvar() && !env.is_search_hinted(vd))
-        non_func.insert(vd);
+    const auto &ids = env.vardecl_ids();
+    const IdSet &hinted = env.search_hinted_ids();
+    IdSet non_func(ids.size());
+    for (std::size_t id = 0; id < ids.size(); ++id) {
+      auto vd = ids[id];
+      if (vd->e() == nullptr && vd->toplevel() && vd->type().isvar() && !hinted.contains(id))
+        non_func.insert(id);
     }
 
+    auto erase = [&ids, &non_func](const MiniZinc::VarDecl *vd) {
+      const std::size_t id = ids.id_of(vd);
+      if (id != DenseIds<MiniZinc::VarDecl>::NONE)
+        non_func.erase(id);
+    };
     for (auto vde : env.equal_constrained()) {
-      auto vd = vde.first;
-      non_func.erase(vd);
+      erase(vde.first);
     }
     for (auto vde : env.array_equal_constrained()) {
-      auto vd = vde.first;
-      non_func.erase(vd);
+      erase(vde.first);
     }
 
-    equal_constrained_functions(env, non_func);
+    equal_constrained_functions(env, erase);
 
-    for (auto vd : non_func) {
-      const auto &loc = vd->loc();
+    non_func.for_each([&](std::size_t id) {
+      const auto &loc = ids[id]->loc();
       env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
                          "possibly non-functionally defined variable not in search hint");
-    }
+    });
   }
 
-  void equal_constrained_functions(LintEnv &env, VDSet &non_func) const {
-    const auto s =
-        env.userdef_only_builder().in_constraint().under(ExpressionId::E_CALL).capture().build();
-    auto ms = s.search(env.model());
+  template <typename Erase>
+  void equal_constrained_functions(LintEnv &env, Erase erase) const {
+    std::vector<const MiniZinc::Call *> calls;
+    auto ms = env.search_model(call_search(env));
     while (ms.next()) {
-      auto call = ms.capture_cast<MiniZinc::Call>(0);
-      auto [pb, pe] = ms.current_path();
-      assert(pb != pe);
-      ++pb;
-      if (!is_conjunctive(pb, pe))
-        continue;
+      if (ms.context() == FlatTree::Context::conjunctive)
+        calls.push_back(ms.capture_cast<MiniZinc::Call>(0));
+    }
 
-      Vis visited;
-      auto args = function_funcdef(call, visited, s);
-      assert(args.size() == call->argCount());
+    const Summaries summaries = summarise(env.flat_tree(), calls);
+    for (auto call : calls) {
+      auto it = summaries.find(call->decl());
+      if (it == summaries.end())
+        continue;
+      const auto &defines = it->second.defines;
+      assert(defines.size() == call->argCount());
 
-      for (unsigned int i = 0; i < args.size(); i++) {
-        if (args[i]) {
+      for (unsigned int i = 0; i < defines.size(); i++) {
+        if (defines[i]) {
           auto vd = argument_to_vardecl(call->arg(i));
           if (vd != nullptr && vd->toplevel() && vd->type().isvar()) {
-            non_func.erase(vd);
+            erase(vd);
           }
         }
       }
     }
   }
 
-  std::vector<bool> function_funcdef(const MiniZinc::Call *call, Vis &visited,
-                                     const Search &call_search) const {
-    assert(call != nullptr);
-    std::vector<bool> ans(call->argCount(), false);
-
-    auto decl = call->decl();
-    if (decl == nullptr || decl->fromStdLib() || decl->e() == nullptr)
-      return ans;
+  // Whether the body of `fi` can be analysed.
+  static bool has_summary(const MiniZinc::FunctionI *fi) {
+    return fi != nullptr && !fi->fromStdLib() && fi->e() != nullptr;
+  }
 
-    if (visited.count(decl) == 0) {
-      visited.insert(decl);
-    } else {
-      std::cerr << "cyclic function calls detected" << std::endl;
-      return ans;
+  // Summarise every function reachable from `calls`, with their bodies as found in `tree`. The
+  // body of each function is analysed once, then the parameters defined through calls are
+  // propagated in callee-first order until nothing changes, which also settles recursive functions.
+  Summaries summarise(const FlatTree &tree,
+                      const std::vector<const MiniZinc::Call *> &calls) const {
+    Summaries summaries;
+    std::vector<const MiniZinc::FunctionI *> postorder;
+    // depth first over the call graph, a function is finished when all its callees are
+    std::vector<std::pair<const MiniZinc::FunctionI *, std::size_t>> stack;
+    auto discover = [&](const MiniZinc::FunctionI *fi) {
+      if (has_summary(fi) && summaries.count(fi) == 0) {
+        summaries.emplace(fi, summarise_body(tree, fi));
+        stack.emplace_back(fi, 0);
+      }
+    };
+    for (auto call : calls) {
+      discover(call->decl());
+      while (!stack.empty()) {
+        auto &[fi, next] = stack.back();
+        const auto &passed = summaries.at(fi).passed;
+        if (next == passed.size()) {
+          postorder.push_back(fi);
+          stack.pop_back();
+        } else {
+          discover(passed[next++].callee);
+        }
+      }
     }
 
-    auto set_funcdef = [&](const MiniZinc::VarDecl *vd) {
-      assert(call->decl()->params().size() == ans.size());
-      for (unsigned int i = 0; i < ans.size(); ++i) {
-        if (call->decl()->params()[i] == vd) {
-          ans[i] = true;
-          break;
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (auto fi : postorder) {
+        Summary &summary = summaries.at(fi);
+        for (const PassedParam &p : summary.passed) {
+          if (summary.defines[p.param])
+            continue;
+          const auto callee = summaries.find(p.callee);
+          if (callee != summaries.end() && callee->second.defines[p.arg]) {
+            summary.defines[p.param] = true;
+            changed = true;
+          }
         }
       }
+    }
+    return summaries;
+  }
+
+  // The parameters `fi` defines by itself, and the ones it passes on in conjunctive calls. The body
+  // is looked at in `tree`, or in a tree of its own if it isn't there.
+  Summary summarise_body(const FlatTree &tree, const MiniZinc::FunctionI *fi) const {
+    const std::size_t node = tree.index_of(fi->e());
+    if (node == FlatTree::NONE) {
+      const FlatTree own(fi->e());
+      return summarise_body(own, 0, fi);
+    }
+    return summarise_body(tree, node, fi);
+  }
+
+  Summary summarise_body(const FlatTree &tree, std::size_t body,
+                         const MiniZinc::FunctionI *fi) const {
+    const auto params = fi->params();
+    Summary summary{std::vector<bool>(params.size(), false), {}};
+    auto param_index = [&params](const MiniZinc::VarDecl *vd) -> std::optional<unsigned int> {
+      for (unsigned int i = 0; i < params.size(); ++i) {
+        if (vd != nullptr && params[i] == vd)
+          return i;
+      }
+      return std::nullopt;
+    };
+    auto set_funcdef = [&](const MiniZinc::VarDecl *vd) {
+      if (auto i = param_index(vd))
+        summary.defines[*i] = true;
     };
 
-    equal_constrained_variables(decl->e(), [&](const MiniZinc::BinOp *, const MiniZinc::Id *id) {
+    equal_constrained_variables(tree, body, [&](const MiniZinc::BinOp *, const MiniZinc::Id *id) {
       set_funcdef(id->decl());
     });
-    equal_constrained_access(decl->e(),
+    equal_constrained_access(tree, body,
                              [&](const MiniZinc::BinOp *, const MiniZinc::ArrayAccess *,
                                  const MiniZinc::Id *id, const MiniZinc::Expression *,
                                  const MiniZinc::Comprehension *) { set_funcdef(id->decl()); });
 
-    auto ms = call_search.search(decl->e());
-    while (ms.next()) {
-      auto call2 = ms.capture_cast<MiniZinc::Call>(0);
-      auto [pb, pe] = ms.current_path();
+    using Calls = Pattern<Under<ExpressionId::E_CALL, Capture>>;
+    Calls::search(tree, body, [&](const Calls::Hit &hit, FlatTree::PathIters path) {
+      auto [call] = hit;
+      auto [pb, pe] = path;
       assert(pb != pe);
       ++pb;
-      if (!is_conjunctive(pb, pe))
-        continue;
-
-      auto args = function_funcdef(call2, visited, call_search);
-      assert(args.size() == call2->argCount());
-
-      for (unsigned int i = 0; i < args.size(); i++) {
-        if (args[i]) {
-          set_funcdef(argument_to_vardecl(call2->arg(i)));
-        }
+      if (!is_conjunctive(pb, pe) || !has_summary(call->decl()))
+        return;
+      for (unsigned int arg = 0; arg < call->argCount(); ++arg) {
+        if (auto i = param_index(argument_to_vardecl(call->arg(arg))))
+          summary.passed.push_back({call->decl(), arg, *i});
       }
-    }
-
-    visited.erase(decl);
-    return ans;
+    });
+    return summary;
   }
 
   static const MiniZinc::VarDecl *argument_to_vardecl(const MiniZinc::Expression *arg) {
@@ -132,7 +207,7 @@ private:
     if (auto call = arg->dynamicCast<MiniZinc::Call>();
         // TODO: allow all functions that take one argument and returns something with the same (or
         // similar) type?
-        call != nullptr && call->argCount() == 1 && call->id() == MiniZinc::ASTString("array1d")) {
+        call != nullptr && call->argCount() == 1 && strcmp(call->id().c_str(), "array1d") == 0) {
       return argument_to_vardecl(call->arg(0));
     }
     if (auto acc = arg->dynamicCast<MiniZinc::ArrayAccess>(); acc != nullptr) {
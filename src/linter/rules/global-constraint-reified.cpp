@@ -11,7 +11,8 @@ using namespace LZN;
 
 class GlobalConstraintReified : public LintRule {
 public:
-  constexpr GlobalConstraintReified() : LintRule(17, "global-reified", Category::UNSURE) {}
+  constexpr GlobalConstraintReified()
+      : LintRule(17, "global-reified", Category::UNSURE, /*thread_safe=*/true) {}
 
 private:
   using ExpressionId = MiniZinc::Expression::ExpressionId;
@@ -19,27 +20,26 @@ private:
   virtual void do_run(LintEnv &env) const override {
     const auto s = env.userdef_only_builder().under(ExpressionId::E_CALL).capture().build();
 
-    for (auto con : env.constraints()) {
-      auto ms = s.search(con);
-
-      while (ms.next()) {
-        auto call = ms.capture_cast<MiniZinc::Call>(0);
-        auto decl = call->decl();
-        if (decl == nullptr)
-          continue;
-
-        auto decl_path = decl->loc().filename();
-        auto [pathbegin, pathend] = ms.current_path();
-        assert(pathbegin != pathend);
-        ++pathbegin;
-
-        if (s.include_path() != nullptr && decl_path.size() > 0 &&
-            path_included_from(*s.include_path(), decl_path) && decl->ti()->type().isvarbool() &&
-            !decl->fromStdLib() && !is_conjunctive(pathbegin, pathend)) {
-          const auto &loc = call->loc();
-          env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
-                             "reified global constraint");
-        }
+    const auto &constraints = env.constraints();
+    auto ms = s.search(constraints.begin(), constraints.end());
+
+    while (ms.next()) {
+      auto call = ms.capture_cast<MiniZinc::Call>(0);
+      auto decl = call->decl();
+      if (decl == nullptr)
+        continue;
+
+      auto decl_path = decl->loc().filename();
+      auto [pathbegin, pathend] = ms.current_path();
+      assert(pathbegin != pathend);
+      ++pathbegin;
+
+      if (s.include_path() != nullptr && decl_path.size() > 0 &&
+          path_included_from(*s.include_path(), decl_path) && decl->ti()->type().isvarbool() &&
+          !decl->fromStdLib() && !is_conjunctive(pathbegin, pathend)) {
+        const auto &loc = call->loc();
+        env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
+                           "reified global constraint");
       }
     }
   }
@@ -6,23 +6,30 @@ using namespace LZN;
 
 class GlobalsInFunction : public LintRule {
 public:
-  constexpr GlobalsInFunction() : LintRule(5, "globals-in-function", Category::STYLE) {}
+  constexpr GlobalsInFunction()
+      : LintRule(5, "globals-in-function", Category::STYLE, /*thread_safe=*/true) {}
 
 private:
-  using ExpressionId = MiniZinc::Expression::ExpressionId;
+  void check_uses(LintEnv &env, DefUseIndex::Row<DefUseIndex::Use> uses) const {
+    for (const auto &use : uses) {
+      auto id = use.site->dynamicCast<MiniZinc::Id>();
+      if (id != nullptr && id->decl()->toplevel() && id->type().isvar()) {
+        const auto &loc = id->loc();
+        env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
+                           "avoid using globals in functions, pass as an argument instead");
+      }
+    }
+  }
 
   virtual void do_run(LintEnv &env) const override {
-    const auto s = env.userdef_only_builder().under(ExpressionId::E_ID).capture().build();
+    const DefUseIndex &index = env.def_use();
 
     for (auto fun : env.user_defined_functions()) {
-      auto ms = s.search(fun->e());
-      while (ms.next()) {
-        auto id = ms.capture_cast<MiniZinc::Id>(0);
-        if (id->decl() != nullptr && id->decl()->toplevel() && id->type().isvar()) {
-          const auto &loc = id->loc();
-          env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
-                             "avoid using globals in functions, pass as an argument instead");
-        }
+      // the body uses some ids itself, the declarations in it use the rest
+      const std::size_t f = index.number_of(fun);
+      check_uses(env, index.uses(f));
+      for (std::size_t vd : index.contained(f)) {
+        check_uses(env, index.uses(vd));
       }
     }
   }
@@ -13,28 +13,16 @@ bool isNoDomainVar(const MiniZinc::VarDecl &vd) {
          t.dim() >= 0 && t.isPresent() && domain == nullptr;
 }
 
-bool isGeneratorVar(const MiniZinc::VarDecl *vd, LintEnv &env) {
-  auto comps = env.comprehensions();
-  for (const MiniZinc::Comprehension *c : comps) {
-    for (unsigned int gen = 0; gen < c->numberOfGenerators(); gen++) {
-      for (unsigned int decl = 0; decl < c->numberOfDecls(gen); decl++) {
-        if (vd == c->decl(gen, decl))
-          return true;
-      }
-    }
-  }
-  return false;
-}
-
 class NoDomainVarDecl : public LintRule {
 public:
-  constexpr NoDomainVarDecl() : LintRule(13, "unbounded-variable", Category::PERFORMANCE) {}
+  constexpr NoDomainVarDecl()
+      : LintRule(13, "unbounded-variable", Category::PERFORMANCE, /*thread_safe=*/true) {}
 
 private:
   virtual void do_run(LintEnv &env) const override {
     for (const MiniZinc::VarDecl *vd : env.user_defined_variable_declarations()) {
       if (isNoDomainVar(*vd) && vd->e() == nullptr &&
-          env.get_equal_constrained_rhs(vd) == nullptr && !isGeneratorVar(vd, env)) {
+          env.get_equal_constrained_rhs(vd) == nullptr && env.generator_of(vd) == nullptr) {
         auto &loc = vd->loc();
         env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
                            "no explicit domain on variable declaration");
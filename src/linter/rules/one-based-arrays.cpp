@@ -1,7 +1,7 @@
 #include <algorithm>
 #include <linter/registry.hpp>
 #include <linter/rules.hpp>
-#include <minizinc/eval_par.hh>
+#include <linter/utils.hpp>
 
 namespace {
 using namespace LZN;
@@ -10,45 +10,47 @@ using namespace LZN;
 // doesn't know.
 class OneBasedArrays : public LintRule {
 public:
-  constexpr OneBasedArrays() : LintRule(19, "one-based-arrays", Category::PERFORMANCE) {}
+  constexpr OneBasedArrays()
+      : LintRule(19, "one-based-arrays", Category::PERFORMANCE, /*thread_safe=*/true) {}
 
 private:
   using BT = MiniZinc::BinOpType;
 
-  bool starts_at_one(const MiniZinc::TypeInst *ti) const {
-    auto followed = MiniZinc::follow_id(ti->domain());
+  // Only the lower end has to be 1, so `1..n` starts at one even if `n` has no value. A lower bound
+  // of 1 isn't enough for `m..10` though, as `m` can be more than 1.
+  bool starts_at_one(LintEnv &env, const MiniZinc::TypeInst *ti) const {
+    auto followed = follow_id(ti->domain());
     if (followed == nullptr)
       return false;
 
     if (auto setlit = followed->dynamicCast<MiniZinc::SetLit>(); setlit != nullptr) {
-      if (auto isv = setlit->isv(); isv != nullptr) {
-        return isv->min() == MiniZinc::IntVal(1);
-      } else if (setlit->v().size() > 0) {
-        return std::any_of(setlit->v().begin(), setlit->v().end(), [](MiniZinc::Expression *e) {
-          if (auto intval = e->dynamicCast<MiniZinc::IntLit>(); intval != nullptr) {
-            return intval->v() == MiniZinc::IntVal(1);
-          }
-          return false;
-        });
-      }
+      const IntInterval bounds = env.int_bounds(setlit);
+      if (setlit->isv() != nullptr)
+        return bounds.min_known && bounds.min == 1;
+      // 1 is an element and nothing is known to be smaller, so `{1, n}` starts at one
+      return (!bounds.min_known || bounds.min == 1) && has_one(env, setlit);
     } else if (auto set = followed->dynamicCast<MiniZinc::BinOp>();
                set != nullptr && set->op() == BT::BOT_DOTDOT) {
-      auto min = set->lhs()->dynamicCast<MiniZinc::IntLit>();
-      if (min == nullptr)
-        return false;
-      return min->v() == MiniZinc::IntVal(1);
+      return env.int_bounds(set->lhs()).is(1, 1);
     }
-
     return false;
   }
 
+  // Returns true if the set literal `setlit` has 1 as an element, like `{1, n}` whatever `n` is.
+  static bool has_one(LintEnv &env, const MiniZinc::SetLit *setlit) {
+    const auto elems = setlit->v();
+    return std::any_of(elems.begin(), elems.end(), [&env](const MiniZinc::Expression *elem) {
+      return env.int_bounds(elem).is(1, 1);
+    });
+  }
+
   virtual void do_run(LintEnv &env) const override {
     for (auto vd : env.user_defined_variable_declarations()) {
       if (!vd->ti()->isarray())
         continue;
 
       for (auto r : vd->ti()->ranges()) {
-        if (r->domain() != nullptr && !starts_at_one(r)) {
+        if (r->domain() != nullptr && !starts_at_one(env, r)) {
           const auto &loc = r->loc();
           auto &lr = env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
                                         "better to start at 1");
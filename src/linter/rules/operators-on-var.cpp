@@ -8,22 +8,38 @@ using namespace LZN;
 
 class OperatorsOnVar : public LintRule {
 public:
-  constexpr OperatorsOnVar() : LintRule(18, "operator-on-var", Category::UNSURE) {}
+  constexpr OperatorsOnVar()
+      : LintRule(18, "operator-on-var", Category::UNSURE, /*thread_safe=*/true, RuleScope::ITEM) {}
 
 private:
   using ExpressionId = MiniZinc::Expression::ExpressionId;
   using BT = MiniZinc::BinOpType;
   using UT = MiniZinc::UnOpType;
 
+  static Search binop_search(const LintEnv &env) {
+    return env.userdef_only_builder()
+        .in_everywhere()
+        .under(ExpressionId::E_BINOP)
+        .capture()
+        .build();
+  }
+
+  static Search not_search(const LintEnv &env) {
+    return env.userdef_only_builder().in_everywhere().under(UT::UOT_NOT).capture().build();
+  }
+
+  virtual void do_prepare(LintEnv &env) const override {
+    env.request_search(binop_search(env));
+    env.request_search(not_search(env));
+  }
+
   virtual void do_run(LintEnv &env) const override {
     find_binop(env);
     find_unop(env);
   }
 
   void find_binop(LintEnv &env) const {
-    const auto s =
-        env.userdef_only_builder().in_everywhere().under(ExpressionId::E_BINOP).capture().build();
-    auto ms = s.search(env.model());
+    auto ms = env.search_model(binop_search(env));
 
     while (ms.next()) {
       auto bin = ms.capture_cast<MiniZinc::BinOp>(0);
@@ -63,8 +79,7 @@ private:
   }
 
   void find_unop(LintEnv &env) const {
-    const auto s = env.userdef_only_builder().in_everywhere().under(UT::UOT_NOT).capture().build();
-    auto ms = s.search(env.model());
+    auto ms = env.search_model(not_search(env));
 
     while (ms.next()) {
       auto unop = ms.capture_cast<MiniZinc::UnOp>(0);
@@ -7,16 +7,24 @@ using namespace LZN;
 
 class VarInGen : public LintRule {
 public:
-  constexpr VarInGen() : LintRule(7, "var-in-gen", Category::UNSURE) {}
+  constexpr VarInGen()
+      : LintRule(7, "var-in-gen", Category::UNSURE, /*thread_safe=*/true, RuleScope::ITEM) {}
 
 private:
+  static Search comprehension_search(const LintEnv &env) {
+    return env.userdef_only_builder()
+        .in_everywhere()
+        .under(MiniZinc::Expression::E_COMP)
+        .capture()
+        .build();
+  }
+
+  virtual void do_prepare(LintEnv &env) const override {
+    env.request_search(comprehension_search(env));
+  }
+
   virtual void do_run(LintEnv &env) const override {
-    const auto s = env.userdef_only_builder()
-                       .in_everywhere()
-                       .under(MiniZinc::Expression::E_COMP)
-                       .capture()
-                       .build();
-    auto ms = s.search(env.model());
+    auto ms = env.search_model(comprehension_search(env));
 
     while (ms.next()) {
       auto comp = ms.capture_cast<MiniZinc::Comprehension>(0);
@@ -7,21 +7,38 @@ using namespace LZN;
 
 class VarInIfWhere : public LintRule {
 public:
-  constexpr VarInIfWhere() : LintRule(26, "var-in-if-where", Category::UNSURE) {}
+  constexpr VarInIfWhere()
+      : LintRule(26, "var-in-if-where", Category::UNSURE, /*thread_safe=*/true, RuleScope::ITEM) {}
 
 private:
+  static Search comprehension_search(const LintEnv &env) {
+    return env.userdef_only_builder()
+        .in_everywhere()
+        .under(MiniZinc::Expression::E_COMP)
+        .capture()
+        .build();
+  }
+
+  static Search ite_search(const LintEnv &env) {
+    return env.userdef_only_builder()
+        .in_everywhere()
+        .under(MiniZinc::Expression::E_ITE)
+        .capture()
+        .build();
+  }
+
+  virtual void do_prepare(LintEnv &env) const override {
+    env.request_search(comprehension_search(env));
+    env.request_search(ite_search(env));
+  }
+
   virtual void do_run(LintEnv &env) const override {
     find_where(env);
     find_if(env);
   }
 
   void find_where(LintEnv &env) const {
-    const auto s = env.userdef_only_builder()
-                       .in_everywhere()
-                       .under(MiniZinc::Expression::E_COMP)
-                       .capture()
-                       .build();
-    auto ms = s.search(env.model());
+    auto ms = env.search_model(comprehension_search(env));
 
     while (ms.next()) {
       auto comp = ms.capture_cast<MiniZinc::Comprehension>(0);
@@ -41,12 +58,7 @@ private:
   }
 
   void find_if(LintEnv &env) const {
-    const auto s = env.userdef_only_builder()
-                       .in_everywhere()
-                       .under(MiniZinc::Expression::E_ITE)
-                       .capture()
-                       .build();
-    auto ms = s.search(env.model());
+    auto ms = env.search_model(ite_search(env));
 
     while (ms.next()) {
       auto ite = ms.capture_cast<MiniZinc::ITE>(0);
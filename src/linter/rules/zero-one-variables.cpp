@@ -1,65 +1,70 @@
 #include <linter/registry.hpp>
 #include <linter/rules.hpp>
 #include <linter/utils.hpp>
-#include <minizinc/astexception.hh>
 
 namespace {
 using namespace LZN;
 
 class ZeroOneVars : public LintRule {
 public:
-  constexpr ZeroOneVars() : LintRule(22, "zero-one-vars", Category::PERFORMANCE) {}
+  constexpr ZeroOneVars()
+      : LintRule(22, "zero-one-vars", Category::PERFORMANCE, /*thread_safe=*/false) {}
 
 private:
   using ExpressionId = MiniZinc::Expression::ExpressionId;
   using BT = MiniZinc::BinOpType;
 
-  struct Searchers {
-    const Search searcher_non_toplevel_var_in_access;
-  };
+  virtual void do_prepare(LintEnv &env) const override {
+    env.request_search(sum_search(env));
+    env.request_search(impl_search(env));
+  }
 
   virtual void do_run(LintEnv &env) const override {
-    const Searchers searchers{env.userdef_only_builder()
-                                  .global_filter(filter_out_annotations)
-                                  .under(ExpressionId::E_ARRAYACCESS)
-                                  .filter(filter_arrayaccess_idx)
-                                  .under(ExpressionId::E_ID)
-                                  .capture()
-                                  .build()};
+    case_impl(env, BT::BOT_LQ, MiniZinc::IntVal(1)); // expr1 = 1 -> expr2 = 1
+    case_impl(env, BT::BOT_GQ, MiniZinc::IntVal(0)); // expr1 = 0 -> expr2 = 0
+    case_sum(env);
+  }
 
-    case_impl(env, searchers, BT::BOT_LQ, MiniZinc::IntVal(1)); // expr1 = 1 -> expr2 = 1
-    case_impl(env, searchers, BT::BOT_GQ, MiniZinc::IntVal(0)); // expr1 = 0 -> expr2 = 0
-    case_sum(env, searchers);
+  static Search sum_search(const LintEnv &env) {
+    return env.userdef_only_builder()
+        .in_everywhere()
+        .under(MiniZinc::constants().ids.sum)
+        .capture()
+        .direct(ExpressionId::E_COMP)
+        .capture()
+        .filter(filter_comprehension_body)
+        .direct(MiniZinc::constants().ids.bool2int)
+        .capture()
+        .direct(BT::BOT_EQ)
+        .capture()
+        .direct(ExpressionId::E_ARRAYACCESS)
+        .capture()
+        .filter(filter_arrayaccess_name)
+        .direct(ExpressionId::E_ID)
+        .capture()
+        .build();
   }
 
-  void case_sum(LintEnv &env, const Searchers &searchers) const {
-    const auto s = env.userdef_only_builder()
-                       .in_everywhere()
-                       .under(ExpressionId::E_CALL)
-                       .capture()
-                       .direct(ExpressionId::E_COMP)
-                       .capture()
-                       .filter(filter_comprehension_body)
-                       .direct(ExpressionId::E_CALL)
-                       .capture()
-                       .direct(BT::BOT_EQ)
-                       .capture()
-                       .direct(ExpressionId::E_ARRAYACCESS)
-                       .capture()
-                       .filter(filter_arrayaccess_name)
-                       .direct(ExpressionId::E_ID)
-                       .capture()
-                       .build();
-    auto ms = s.search(env.model());
+  static Search impl_search(const LintEnv &env) {
+    return env.userdef_only_builder()
+        .in_everywhere()
+        .under(BT::BOT_IMPL)
+        .capture()
+        .filter([](const auto *impl, const auto *side) -> bool {
+          return impl->template cast<MiniZinc::BinOp>()->lhs() == side;
+        })
+        .direct(BT::BOT_EQ)
+        .capture()
+        .direct(ExpressionId::E_INTLIT)
+        .capture()
+        .build();
+  }
+
+  void case_sum(LintEnv &env) const {
+    auto ms = env.search_model(sum_search(env));
 
     while (ms.next()) {
       const auto sum = ms.capture_cast<MiniZinc::Call>(0);
-      if (sum->id() != MiniZinc::constants().ids.sum)
-        continue;
-      const auto bool2int = ms.capture_cast<MiniZinc::Call>(2);
-      if (bool2int->id() != MiniZinc::constants().ids.bool2int)
-        continue;
-
       const auto comp = ms.capture_cast<MiniZinc::Comprehension>(1);
       const auto eq = ms.capture_cast<MiniZinc::BinOp>(3);
       const auto access = ms.capture_cast<MiniZinc::ArrayAccess>(4);
@@ -79,34 +84,20 @@ private:
         continue;
       if (!comprehension_covers_whole_array(comp, decl))
         continue;
-      if (!is_zero_one_expr(env, searchers, access))
+      if (!is_zero_one_expr(env, access))
         continue;
 
       const auto &loc = sum->loc();
       auto &res = env.emplace_result(FileContents::Type::OneLineMarked, loc, this,
                                      "abuse 0..1 domain", sum_rewrite(id));
-      if (depends_on_instance(decl->ti()->domain())) {
+      if (env.depends_on_instance(decl->ti()->domain())) {
         res.set_depends_on_instance();
       }
       res.emplace_subresult("has domain 0..1", FileContents::Type::OneLineMarked, access->loc());
     }
   }
 
-  void case_impl(LintEnv &env, const Searchers &searchers, BT rewrite_type,
-                 MiniZinc::IntVal equal_to) const {
-    const auto main_searcher = env.userdef_only_builder()
-                                   .in_everywhere()
-                                   .under(BT::BOT_IMPL)
-                                   .capture()
-                                   .filter([](const auto *impl, const auto *side) -> bool {
-                                     return impl->template cast<MiniZinc::BinOp>()->lhs() == side;
-                                   })
-                                   .direct(BT::BOT_EQ)
-                                   .capture()
-                                   .direct(ExpressionId::E_INTLIT)
-                                   .capture()
-                                   .build();
-
+  void case_impl(LintEnv &env, BT rewrite_type, MiniZinc::IntVal equal_to) const {
     const auto off_searcher = env.userdef_only_builder()
                                   .direct(BT::BOT_EQ)
                                   .capture()
@@ -114,7 +105,7 @@ private:
                                   .capture()
                                   .build();
 
-    auto main = main_searcher.search(env.model());
+    auto main = env.search_model(impl_search(env));
 
     while (main.next()) {
       if (main.capture_cast<MiniZinc::IntLit>(2)->v() != equal_to)
@@ -130,14 +121,14 @@ private:
       auto expr1 = other_side(main.capture_cast<MiniZinc::BinOp>(1), main.capture(2));
       auto expr2 = other_side(off.capture_cast<MiniZinc::BinOp>(0), off.capture(1));
 
-      if (!is_zero_one_expr(env, searchers, expr1) || !is_zero_one_expr(env, searchers, expr2))
+      if (!is_zero_one_expr(env, expr1) || !is_zero_one_expr(env, expr2))
         continue;
 
       const auto &loc = main.capture(0)->loc();
       auto &res =
           env.emplace_result(FileContents::Type::OneLineMarked, loc, this, "abuse 0..1 domain",
                              binary_rewrite(rewrite_type, expr1, expr2));
-      if (depends_on_instance(expr1) || depends_on_instance(expr2)) {
+      if (env.depends_on_instance(expr1) || env.depends_on_instance(expr2)) {
         res.set_depends_on_instance();
       }
 
@@ -163,57 +154,10 @@ private:
                               {mut_arr_id});
   }
 
-  bool contains_non_toplevel_var_in_access(const MiniZinc::Expression *e,
-                                           const Searchers &searchers) const {
-    auto ms = searchers.searcher_non_toplevel_var_in_access.search(e);
-    while (ms.next()) {
-      auto id = ms.capture_cast<MiniZinc::Id>(0);
-      if (id->decl() != nullptr && !id->decl()->toplevel())
-        return true;
-    }
-    return false;
-  }
-
-  bool is_zero_one_expr(LintEnv &env, const Searchers &searchers,
-                        const MiniZinc::Expression *e) const {
+  bool is_zero_one_expr(LintEnv &env, const MiniZinc::Expression *e) const {
     if (e == nullptr)
       return false;
-
-    // TODO: compute_int_bounds crashes (assertion fails) if `e` contains an array access using
-    // generators.
-    // forall(i in 1..4)(xs[i]) would crash if e = xs[i].
-    // Check bounds manually instead if e happens to be an array access.
-    if (contains_non_toplevel_var_in_access(e, searchers)) {
-      if (auto access = e->dynamicCast<MiniZinc::ArrayAccess>(); access != nullptr) {
-        if (auto id = access->v()->dynamicCast<MiniZinc::Id>(); id != nullptr) {
-          if (id->decl() != nullptr) {
-            return is_zero_one_intlit(id->decl()->ti());
-          }
-        }
-      }
-      return false;
-    }
-
-    std::optional<MiniZinc::IntBounds> bounds;
-    try {
-      bounds = compute_int_bounds(env.minizinc_env().envi(), e);
-    } catch (const MiniZinc::LocationException &exc) { return false; }
-    assert(bounds);
-
-    return bounds->valid && bounds->l == MiniZinc::IntVal(0) && bounds->u == MiniZinc::IntVal(1);
-  }
-
-  bool is_zero_one_intlit(MiniZinc::TypeInst *ti) const {
-    auto followed = MiniZinc::follow_id(ti->domain());
-    if (followed == nullptr)
-      return false;
-
-    if (auto setlit = followed->dynamicCast<MiniZinc::SetLit>(); setlit != nullptr) {
-      if (auto isv = setlit->isv(); isv != nullptr) {
-        return isv->min() == MiniZinc::IntVal(0) && isv->max() == MiniZinc::IntVal(1);
-      }
-    }
-    return false;
+    return env.int_bounds(e).is(0, 1);
   }
 };
 
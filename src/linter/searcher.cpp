@@ -1,37 +1,164 @@
 #include "searcher.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
 #include <linter/file_utils.hpp>
-#include <minizinc/astiterator.hh>
 #include <minizinc/model.hh>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 namespace {
 using namespace LZN;
 
-std::size_t children_of(const MiniZinc::Expression *root,
-                        std::vector<const MiniZinc::Expression *> &results) {
+// Mix the hash `h` into `seed`.
+void hash_combine(std::size_t &seed, std::size_t h) {
+  seed ^= h + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+}
+
+// Call `f(child)` for every direct child of `root` that isn't nullptr, in the order
+// `MiniZinc::top_down` would visit them, followed by the annotations of `root`.
+template <typename F>
+void for_each_child(const MiniZinc::Expression *root, F f) {
   assert(root != nullptr);
+  using E = MiniZinc::Expression;
 
-  struct : MiniZinc::EVisitor {
-    std::vector<const MiniZinc::Expression *> *results;
-    std::size_t new_children = 0;
-    const MiniZinc::Expression *root;
-
-    bool enter(MiniZinc::Expression *child) {
-      if (child == root) {
-        return true;
-      } else {
-        results->push_back(child);
-        ++new_children;
-        return false;
+  auto visit = [&f](const E *child) {
+    if (child != nullptr)
+      f(child);
+  };
+  auto visit_reversed = [&visit](const auto &vec) {
+    for (auto i = vec.size(); i-- > 0;) {
+      visit(vec[i]);
+    }
+  };
+
+  switch (root->eid()) {
+  case E::E_SETLIT: visit_reversed(root->cast<MiniZinc::SetLit>()->v()); break;
+  case E::E_ARRAYLIT: visit_reversed(*root->cast<MiniZinc::ArrayLit>()); break;
+  case E::E_ARRAYACCESS: {
+    auto aa = root->cast<MiniZinc::ArrayAccess>();
+    visit(aa->v());
+    visit_reversed(aa->idx());
+    break;
+  }
+  case E::E_COMP: {
+    auto comp = root->cast<MiniZinc::Comprehension>();
+    visit(comp->e());
+    for (unsigned int i = 0; i < comp->numberOfGenerators(); ++i) {
+      for (unsigned int j = 0; j < comp->numberOfDecls(i); ++j) {
+        visit(comp->decl(i, j));
       }
+      visit(comp->in(i));
+      visit(comp->where(i));
+    }
+    break;
+  }
+  case E::E_ITE: {
+    auto ite = root->cast<MiniZinc::ITE>();
+    for (auto i = ite->size(); i-- > 0;) {
+      visit(ite->thenExpr(i));
+      visit(ite->ifExpr(i));
+    }
+    visit(ite->elseExpr());
+    break;
+  }
+  case E::E_BINOP: {
+    auto bo = root->cast<MiniZinc::BinOp>();
+    visit(bo->lhs());
+    visit(bo->rhs());
+    break;
+  }
+  case E::E_UNOP: visit(root->cast<MiniZinc::UnOp>()->e()); break;
+  case E::E_CALL: {
+    auto call = root->cast<MiniZinc::Call>();
+    for (auto i = call->argCount(); i-- > 0;) {
+      visit(call->arg(i));
+    }
+    break;
+  }
+  case E::E_VARDECL: {
+    auto vd = root->cast<MiniZinc::VarDecl>();
+    visit(vd->ti());
+    visit(vd->e());
+    break;
+  }
+  case E::E_LET: {
+    auto let = root->cast<MiniZinc::Let>();
+    visit_reversed(let->let());
+    visit(let->in());
+    break;
+  }
+  case E::E_TI: {
+    auto ti = root->cast<MiniZinc::TypeInst>();
+    visit_reversed(ti->ranges());
+    visit(ti->domain());
+    break;
+  }
+  default: break; // literals, identifiers and type-inst identifiers have no children
+  }
+
+  for (const E *ann : root->ann()) {
+    visit(ann);
+  }
+}
+
+// Returns true if `search` should ignore `item` because it isn't user defined.
+bool is_ignored_item(const Search &search, const MiniZinc::Item *item) {
+  if (!search.is_user_defined_only())
+    return false;
+
+  // ignore functions from stdlib and introduced functions (enum tostring)
+  if (auto fi = item->dynamicCast<MiniZinc::FunctionI>();
+      fi != nullptr && (fi->fromStdLib() || fi->loc().isIntroduced())) {
+    return true;
+  }
+  // ignore enum definitions from stdlib
+  if (auto vd = item->dynamicCast<MiniZinc::VarDeclI>(); vd != nullptr) {
+    auto filename = vd->e()->loc().filename();
+    if (filename.size() == 0 || path_included_from(*search.include_path(), filename)) {
+      return true;
     }
-  } childExtractor;
-  childExtractor.results = &results;
-  childExtractor.root = root;
+  }
+  return false;
+}
+
+// Call `f(root, loc)` for every expression tree in `item` that can be searched in. `loc` is the
+// location in `SearchLocs` that decides whether `root` should be searched, or nullptr if that is
+// decided by `SearchLocs::should_visit` alone.
+template <typename F>
+void for_each_starting_point(const MiniZinc::Item *item, F f) {
+  using I = MiniZinc::Item;
+  using Impl::SearchLocs;
+
+  auto visit = [&f](const MiniZinc::Expression *root, bool SearchLocs::*loc) {
+    if (root != nullptr)
+      f(root, loc);
+  };
 
-  // NOTE: Assume that top_down doesn't modify root
-  MiniZinc::top_down(childExtractor, const_cast<MiniZinc::Expression *>(root));
-  return childExtractor.new_children;
+  switch (item->iid()) {
+  case I::II_FUN: {
+    auto fi = item->cast<MiniZinc::FunctionI>();
+    visit(fi->e(), &SearchLocs::use_fi_body);
+    visit(fi->ti(), &SearchLocs::use_fi_return);
+    for (auto param : fi->params()) {
+      visit(param, &SearchLocs::use_fi_params);
+    }
+    break;
+  }
+  case I::II_ASN: {
+    auto a = item->cast<MiniZinc::AssignI>();
+    visit(a->e(), &SearchLocs::use_ai_rhs);
+    visit(a->decl(), &SearchLocs::use_ai_decl);
+    break;
+  }
+  case I::II_VD: visit(item->cast<MiniZinc::VarDeclI>()->e(), nullptr); break;
+  case I::II_CON: visit(item->cast<MiniZinc::ConstraintI>()->e(), nullptr); break;
+  case I::II_OUT: visit(item->cast<MiniZinc::OutputI>()->e(), nullptr); break;
+  case I::II_SOL: visit(item->cast<MiniZinc::SolveI>()->e(), nullptr); break;
+  default: break;
+  }
 }
 } // namespace
 
@@ -57,6 +184,23 @@ bool SearchLocs::any() const {
          use_fi_body || use_fi_params || use_fi_return;
 }
 
+bool SearchLocs::operator==(const SearchLocs &other) const noexcept {
+  return std::tie(use_ii, use_vdi, use_ci, use_si, use_oi, use_fi_body, use_fi_params,
+                  use_fi_return, use_ai_rhs, use_ai_decl) ==
+         std::tie(other.use_ii, other.use_vdi, other.use_ci, other.use_si, other.use_oi,
+                  other.use_fi_body, other.use_fi_params, other.use_fi_return, other.use_ai_rhs,
+                  other.use_ai_decl);
+}
+
+std::size_t SearchLocs::hash() const noexcept {
+  std::size_t seed = 0;
+  for (bool b : {use_ii, use_vdi, use_ci, use_si, use_oi, use_fi_body, use_fi_params,
+                 use_fi_return, use_ai_rhs, use_ai_decl}) {
+    seed = seed << 1 | (b ? 1 : 0);
+  }
+  return seed;
+}
+
 bool SearchNode::match(const MiniZinc::Expression *i) const {
   bool right_expr = i->eid() == target;
   if (right_expr && target == ExpressionId::E_BINOP &&
@@ -67,6 +211,11 @@ bool SearchNode::match(const MiniZinc::Expression *i) const {
       !std::holds_alternative<std::monostate>(sub_target)) {
     return std::get<UnOpType>(sub_target) == i->cast<MiniZinc::UnOp>()->op();
   }
+  if (right_expr && target == ExpressionId::E_CALL &&
+      !std::holds_alternative<std::monostate>(sub_target)) {
+    const auto &ids = std::get<CallIds>(sub_target);
+    return std::find(ids.begin(), ids.end(), i->cast<MiniZinc::Call>()->id()) != ids.end();
+  }
   return right_expr;
 }
 
@@ -77,6 +226,77 @@ bool SearchNode::run_filter(const MiniZinc::Expression *p,
   return (*filter_fun)(p, child);
 }
 
+KindSet kinds_of(const MiniZinc::Expression *e) {
+  KindSet ks = kind_bit(e->eid());
+  if (auto bo = e->dynamicCast<MiniZinc::BinOp>(); bo != nullptr)
+    ks |= kind_bit(bo->op());
+  else if (auto uo = e->dynamicCast<MiniZinc::UnOp>(); uo != nullptr)
+    ks |= kind_bit(uo->op());
+  return ks;
+}
+
+ConjunctiveLink conjunctive_link(const MiniZinc::Expression *e) {
+  if (auto bo = e->dynamicCast<MiniZinc::BinOp>(); bo != nullptr)
+    return bo->op() == MiniZinc::BinOpType::BOT_AND ? ConjunctiveLink::passes
+                                                     : ConjunctiveLink::breaks;
+  if (e->isa<MiniZinc::Let>())
+    return ConjunctiveLink::passes;
+  if (auto call = e->dynamicCast<MiniZinc::Call>(); call != nullptr) {
+    const auto &id = call->id();
+    const auto &conts = MiniZinc::constants().ids;
+    const bool passes = strcmp(id.c_str(), "implied_constraint") == 0 || id == conts.assert ||
+                        id == conts.mzn_redundant_constraint ||
+                        id == conts.mzn_symmetry_breaking_constraint;
+    return passes ? ConjunctiveLink::passes : ConjunctiveLink::breaks;
+  }
+  if (auto ite = e->dynamicCast<MiniZinc::ITE>(); ite != nullptr) {
+    for (unsigned int i = 0; i < ite->size(); i++) {
+      if (ite->ifExpr(i)->type().isvar())
+        return ConjunctiveLink::breaks;
+    }
+    return ConjunctiveLink::passes;
+  }
+  if (e->isa<MiniZinc::Comprehension>())
+    return ConjunctiveLink::comprehension;
+  return ConjunctiveLink::breaks;
+}
+
+bool is_forall(const MiniZinc::Expression *e) {
+  auto call = e->dynamicCast<MiniZinc::Call>();
+  return call != nullptr && call->id() == MiniZinc::constants().ids.forall;
+}
+
+KindSet SearchNode::kinds() const noexcept {
+  if (auto bot = std::get_if<BinOpType>(&sub_target); bot != nullptr)
+    return kind_bit(*bot);
+  if (auto uot = std::get_if<UnOpType>(&sub_target); uot != nullptr)
+    return kind_bit(*uot);
+  return kind_bit(target);
+}
+
+bool SearchNode::operator==(const SearchNode &other) const noexcept {
+  return att == other.att && target == other.target && sub_target == other.sub_target &&
+         be_captured == other.be_captured && filter_fun == other.filter_fun;
+}
+
+std::size_t SearchNode::hash() const noexcept {
+  std::size_t seed = std::hash<int>()(static_cast<int>(att));
+  hash_combine(seed, std::hash<int>()(target));
+  hash_combine(seed, sub_target.index());
+  if (auto bot = std::get_if<BinOpType>(&sub_target); bot != nullptr)
+    hash_combine(seed, std::hash<int>()(*bot));
+  else if (auto uot = std::get_if<UnOpType>(&sub_target); uot != nullptr)
+    hash_combine(seed, std::hash<int>()(*uot));
+  else if (auto ids = std::get_if<CallIds>(&sub_target); ids != nullptr) {
+    for (const auto &id : *ids) {
+      hash_combine(seed, std::hash<MiniZinc::ASTString>()(id));
+    }
+  }
+  hash_combine(seed, std::hash<bool>()(be_captured));
+  hash_combine(seed, std::hash<ExprFilterFun>()(filter_fun.value_or(nullptr)));
+  return seed;
+}
+
 bool ExprSearcher::next() {
   while (!dfs_stack.empty()) {
     const MiniZinc::Expression *cur = dfs_stack.back();
@@ -123,44 +343,29 @@ ExprSearcher::PathIters ExprSearcher::current_path() const {
 }
 
 void ExprSearcher::queue_children_of(const MiniZinc::Expression *cur) {
-  auto filter = [this, cur](const MiniZinc::Expression *root, const MiniZinc::Expression *child) {
-    if (global_filters != nullptr) {
-      if (!std::all_of(global_filters->begin(), global_filters->end(),
-                       [=](ExprFilterFun f) { return f(root, child); }))
-        return false;
-    }
-
-    assert(nodes_pos == 0 || !hits.empty());
-    if (nodes_pos > 0 && hits.back() == cur)
-      return nodes.at(nodes_pos - 1).run_filter(root, child);
-
-    return true;
-  };
-
-  std::size_t size_before = dfs_stack.size();
-  children_of(cur, dfs_stack);
-  auto beg = dfs_stack.begin() + size_before;
-  const auto end = dfs_stack.end();
-  dfs_stack.erase(std::remove_if(beg, end,
-                                 [&filter, cur](const MiniZinc::Expression *child) {
-                                   return !filter(cur, child);
-                                 }),
-                  end);
+  assert(nodes_pos == 0 || !hits.empty());
+  // the filter of the latest matched node applies to the children of that node only
+  const SearchNode *matched =
+      nodes_pos > 0 && hits.back() == cur ? &nodes.at(nodes_pos - 1) : nullptr;
+
+  for_each_child(cur, [this, cur, matched](const MiniZinc::Expression *child) {
+    if (global_filters != nullptr &&
+        !std::all_of(global_filters->begin(), global_filters->end(),
+                     [=](ExprFilterFun f) { return f(cur, child); }))
+      return;
+    if (matched != nullptr && !matched->run_filter(cur, child))
+      return;
+    dfs_stack.push_back(child);
+  });
 }
 
 const MiniZinc::Expression *ExprSearcher::capture(std::size_t n) const {
   assert(hits.size() == nodes.size());
   assert(has_result());
 
-  for (std::size_t i = 0; i < hits.size(); ++i) {
-    if (nodes[i].capturable()) {
-      if (n == 0) {
-        return hits[i];
-      }
-      --n;
-    }
-  }
-  throw std::logic_error("n is larger than the number of captures");
+  if (n >= captured.size())
+    throw std::logic_error("n is larger than the number of captures");
+  return hits[captured[n]];
 }
 
 bool ExprSearcher::has_result() const noexcept {
@@ -276,21 +481,8 @@ bool ModelSearcher::next_item() {
   for (; !iters.empty(); advance_iters(), item_child = 0) {
     const MiniZinc::Item *cur = iters_top();
 
-    if (search.is_user_defined_only()) {
-      // ignore functions from stdlib and introduced functions (enum tostring)
-      if (auto fi = cur->dynamicCast<MiniZinc::FunctionI>();
-          fi != nullptr && (fi->fromStdLib() || fi->loc().isIntroduced())) {
-        continue;
-      }
-      // ignore enum definitions from stdlib
-      auto vd = cur->dynamicCast<MiniZinc::VarDeclI>();
-      if (vd != nullptr) {
-        auto filename = vd->e()->loc().filename();
-        if (filename.size() == 0 || path_included_from(*search.include_path(), filename)) {
-          continue;
-        }
-      }
-    }
+    if (is_ignored_item(search, cur))
+      continue;
 
     const MiniZinc::IncludeI *inc;
     if (search.is_recursive() && (inc = cur->dynamicCast<MiniZinc::IncludeI>()) != nullptr &&
@@ -348,6 +540,214 @@ ModelSearcher::ModelSearcher(const MiniZinc::Model *m, const Search &search)
   iters_push(m);
 }
 
+// Implementation of `MultiSearch`. All searches are performed at the same time during a single
+// preorder traversal of a `FlatTree`. The progress of a search is kept as a number of partial
+// matches, called states, one for each way the current path could match the first nodes of the
+// search.
+class MultiSearcher {
+  using Expr = const MiniZinc::Expression *;
+  static constexpr std::size_t NONE = FlatTree::NONE;
+
+  // A partial match of search number `search` where its first `pos` nodes are matched. The latest
+  // matched expression is `matched[last]`, or `NONE` if nothing is matched yet.
+  struct State {
+    std::size_t search;
+    std::size_t pos;
+    std::size_t last;
+  };
+
+  // A matched expression, `prev` points to the previously matched expression of the same state.
+  struct Matched {
+    Expr e;
+    std::size_t prev;
+  };
+
+  // A node on the current path. The states that continue into its children start at
+  // `states_begin` and end where the states of the next frame begin.
+  struct Frame {
+    std::size_t node;
+    std::size_t states_begin;
+    std::size_t matched_begin;
+  };
+
+  const std::vector<const Search *> &searches;
+  const FlatTree &tree;
+  std::vector<SearchHits> results;
+  // `remaining[i][pos]` are the kinds needed to match the nodes of search `i` from `pos` onwards.
+  std::vector<std::vector<KindSet>> remaining;
+
+  std::vector<State> states;
+  std::vector<Matched> matched;
+  std::vector<Frame> frames;
+  std::vector<Expr> captures;
+
+public:
+  MultiSearcher(const std::vector<const Search *> &searches, const FlatTree &tree)
+      : searches(searches), tree(tree) {
+    results.reserve(searches.size());
+    remaining.reserve(searches.size());
+    for (const Search *s : searches) {
+      results.emplace_back(tree, s->num_captures());
+      auto &rem = remaining.emplace_back(s->nodes.size() + 1, 0);
+      for (std::size_t pos = s->nodes.size(); pos-- > 0;) {
+        rem[pos] = rem[pos + 1] | s->nodes[pos].kinds();
+      }
+    }
+  }
+
+  // Search all items in the tree.
+  void search_items() { search_items(0, tree.num_items()); }
+  // Search the items with numbers in `[first, last)`.
+  void search_items(std::size_t first, std::size_t last);
+  // Search the subtree of `top`, ignoring the locations of the searches.
+  void search_subtree(std::size_t top);
+  std::vector<SearchHits> take_results() { return std::move(results); }
+
+private:
+  void search_from(std::size_t top, const MiniZinc::Item *item,
+                   const std::vector<std::size_t> &seeds);
+  bool follows_edge(const State &st, Expr parent, Expr child) const;
+  void enter(const State &st, std::size_t cur, const MiniZinc::Item *item, std::size_t top);
+  void add_hit(const State &st, const MiniZinc::Item *item, std::size_t cur, std::size_t top);
+};
+
+void MultiSearcher::search_items(std::size_t first, std::size_t last) {
+  std::vector<std::size_t> visitors;
+  std::vector<std::size_t> seeds;
+  for (std::size_t it = first; it < last; ++it) {
+    const MiniZinc::Item *item = tree.item(it);
+
+    visitors.clear();
+    for (std::size_t i = 0; i < searches.size(); ++i) {
+      const Search &s = *searches[i];
+      if (!s.locations.should_visit(item))
+        continue;
+      if (s.nodes.empty())
+        results[i].add(item, {}, NONE, NONE);
+      else
+        visitors.push_back(i);
+    }
+    if (visitors.empty())
+      continue;
+
+    const auto [roots_begin, roots_end] = tree.item_roots(it);
+    for (auto root = roots_begin; root < roots_end; ++root) {
+      const auto loc = tree.root_location(root);
+      seeds.clear();
+      for (auto i : visitors) {
+        if (loc == nullptr || searches[i]->locations.*loc)
+          seeds.push_back(i);
+      }
+      if (!seeds.empty())
+        search_from(tree.root_node(root), item, seeds);
+    }
+  }
+}
+
+void MultiSearcher::search_subtree(std::size_t top) {
+  std::vector<std::size_t> seeds;
+  for (std::size_t i = 0; i < searches.size(); ++i) {
+    // there is nothing to find for items only searches in an expression
+    if (!searches[i]->nodes.empty())
+      seeds.push_back(i);
+  }
+  if (!seeds.empty())
+    search_from(top, tree.item_of(top), seeds);
+}
+
+void MultiSearcher::search_from(std::size_t top, const MiniZinc::Item *item,
+                                const std::vector<std::size_t> &seeds) {
+  states.clear();
+  matched.clear();
+  frames.clear();
+
+  const std::size_t end = tree.end(top);
+  for (std::size_t cur = top; cur < end;) {
+    // leave everything that isn't an ancestor of `cur`
+    while (!frames.empty() && !tree.is_ancestor(frames.back().node, cur)) {
+      states.resize(frames.back().states_begin);
+      matched.resize(frames.back().matched_begin);
+      frames.pop_back();
+    }
+
+    const std::size_t states_begin = states.size();
+    const std::size_t matched_begin = matched.size();
+    if (frames.empty()) {
+      for (auto i : seeds) {
+        enter(State{i, 0, NONE}, cur, item, top);
+      }
+    } else {
+      const std::size_t parent = frames.back().node;
+      assert(tree.parent(cur) == parent);
+      for (std::size_t i = frames.back().states_begin; i < states_begin; ++i) {
+        const State st = states[i]; // copy, `enter` might reallocate `states`
+        if (follows_edge(st, tree.expr(parent), tree.expr(cur)))
+          enter(st, cur, item, top);
+      }
+    }
+
+    if (states.size() == states_begin) {
+      // nothing can be matched below `cur`
+      matched.resize(matched_begin);
+      cur = tree.end(cur);
+      continue;
+    }
+
+    frames.push_back(Frame{cur, states_begin, matched_begin});
+    ++cur;
+  }
+}
+
+bool MultiSearcher::follows_edge(const State &st, Expr parent, Expr child) const {
+  const Search &s = *searches[st.search];
+  if (!std::all_of(s.global_filters.begin(), s.global_filters.end(),
+                   [=](ExprFilterFun f) { return f(parent, child); }))
+    return false;
+
+  if (st.last != NONE && matched[st.last].e == parent)
+    return s.nodes[st.pos - 1].run_filter(parent, child);
+
+  return true;
+}
+
+void MultiSearcher::enter(const State &st, std::size_t cur, const MiniZinc::Item *item,
+                          std::size_t top) {
+  // the rest of the search can't be matched anywhere below `cur`
+  if (!tree.may_contain(cur, remaining[st.search][st.pos]))
+    return;
+
+  const auto &nodes = searches[st.search]->nodes;
+  const SearchNode &target = nodes[st.pos];
+
+  if (target.match(tree.expr(cur))) {
+    matched.push_back(Matched{tree.expr(cur), st.last});
+    const State next{st.search, st.pos + 1, matched.size() - 1};
+    if (next.pos == nodes.size())
+      add_hit(next, item, cur, top);
+    else
+      states.push_back(next);
+  }
+
+  // an `under` node could also be matched further down
+  if (target.is_under())
+    states.push_back(st);
+}
+
+void MultiSearcher::add_hit(const State &st, const MiniZinc::Item *item, std::size_t cur,
+                            std::size_t top) {
+  const auto &nodes = searches[st.search]->nodes;
+  captures.clear();
+  std::size_t m = st.last;
+  for (std::size_t i = nodes.size(); i-- > 0;) {
+    assert(m != NONE);
+    if (nodes[i].capturable())
+      captures.push_back(matched[m].e);
+    m = matched[m].prev;
+  }
+  std::reverse(captures.begin(), captures.end());
+  results[st.search].add(item, captures, cur, top);
+}
+
 } // namespace LZN::Impl
 
 namespace LZN {
@@ -365,6 +765,429 @@ bool Search::is_recursive() const noexcept {
   return recursive;
 }
 
+bool Search::operator==(const Search &other) const noexcept {
+  return nodes == other.nodes && locations == other.locations &&
+         numcaptures == other.numcaptures && global_filters == other.global_filters &&
+         includePath == other.includePath && recursive == other.recursive;
+}
+
+std::size_t Search::hash() const noexcept {
+  std::size_t seed = locations.hash();
+  for (const auto &node : nodes) {
+    hash_combine(seed, node.hash());
+  }
+  hash_combine(seed, numcaptures);
+  for (auto f : global_filters) {
+    hash_combine(seed, std::hash<ExprFilterFun>()(f));
+  }
+  hash_combine(seed, std::hash<const void *>()(includePath));
+  hash_combine(seed, std::hash<bool>()(recursive));
+  return seed;
+}
+
+FlatTree::PathIter &FlatTree::PathIter::operator++() {
+  assert(tree != nullptr && node != NONE);
+  node = node == top ? NONE : tree->parent(node);
+  return *this;
+}
+
+FlatTree::FlatTree(const MiniZinc::Model *m, const Search &scope)
+    : includePath(scope.includePath), recursive(scope.recursive) {
+  flatten_model(m, scope);
+}
+
+FlatTree::FlatTree(const MiniZinc::Expression *e) {
+  assert(e != nullptr);
+  flatten(e, nullptr, nullptr);
+}
+
+void FlatTree::flatten_model(const MiniZinc::Model *m, const Search &scope) {
+  for (auto it = m->begin(); it != m->end(); ++it) {
+    const MiniZinc::Item *item = *it;
+    if (is_ignored_item(scope, item))
+      continue;
+
+    items.push_back(ItemEntry{item, roots.size()});
+    for_each_starting_point(item, [this, item](const MiniZinc::Expression *root,
+                                               bool Impl::SearchLocs::*loc) {
+      flatten(root, item, loc);
+    });
+
+    // same order as `ModelSearcher`, the include item first and then the included model
+    if (auto inc = item->dynamicCast<MiniZinc::IncludeI>();
+        inc != nullptr && scope.is_recursive() && scope.is_user_defined_include(inc))
+      flatten_model(inc->m(), scope);
+  }
+}
+
+void FlatTree::flatten(const MiniZinc::Expression *root, const MiniZinc::Item *item,
+                       bool Impl::SearchLocs::*loc) {
+  const std::size_t rootidx = roots.size();
+  roots.push_back(Root{item, loc, nodes.size()});
+
+  // the nodes whose subtrees haven't ended yet
+  std::vector<std::size_t> open;
+  std::vector<std::pair<const MiniZinc::Expression *, std::size_t>> dfs_stack;
+  dfs_stack.emplace_back(root, NONE);
+
+  while (!dfs_stack.empty()) {
+    const auto [cur, parent] = dfs_stack.back();
+    dfs_stack.pop_back();
+
+    const std::size_t idx = nodes.size();
+    while (!open.empty() && open.back() != parent) {
+      close(open.back(), idx);
+      open.pop_back();
+    }
+    Node node{cur, parent, NONE, 0, rootidx, Impl::kinds_of(cur), NONE, NONE, false};
+    set_context(node, idx);
+    nodes.push_back(node);
+    first_index.emplace(cur, idx);
+    open.push_back(idx);
+
+    ::for_each_child(cur, [&dfs_stack, idx](const MiniZinc::Expression *child) {
+      dfs_stack.emplace_back(child, idx);
+    });
+  }
+
+  for (auto it = open.rbegin(); it != open.rend(); ++it) {
+    close(*it, nodes.size());
+  }
+}
+
+void FlatTree::set_context(Node &node, std::size_t idx) const {
+  const std::size_t parent = node.parent;
+  const Node *p = parent == NONE ? nullptr : &nodes[parent];
+  const Node *grandparent = p == nullptr || p->parent == NONE ? nullptr : &nodes[p->parent];
+  node.depth = p == nullptr ? 0 : p->depth + 1;
+
+  switch (Impl::conjunctive_link(node.e)) {
+  case Impl::ConjunctiveLink::passes: node.breaks = p == nullptr ? NONE : p->breaks; break;
+  case Impl::ConjunctiveLink::comprehension:
+    // the forall is part of the comprehension, continue above it
+    if (p != nullptr && Impl::is_forall(p->e))
+      node.breaks = grandparent == nullptr ? NONE : grandparent->breaks;
+    else
+      node.breaks = idx;
+    break;
+  case Impl::ConjunctiveLink::breaks: node.breaks = idx; break;
+  }
+
+  if (p != nullptr) {
+    auto comp = p->e->dynamicCast<MiniZinc::Comprehension>();
+    const bool body_of_forall = comp != nullptr && comp->e() == node.e && grandparent != nullptr &&
+                                Impl::is_forall(grandparent->e);
+    node.forall_comp = body_of_forall ? parent : p->forall_comp;
+  }
+
+  auto uo = node.e->dynamicCast<MiniZinc::UnOp>();
+  const bool is_not = uo != nullptr && uo->op() == MiniZinc::UOT_NOT;
+  node.negated = (p != nullptr && p->negated) != is_not;
+}
+
+void FlatTree::close(std::size_t node, std::size_t end) {
+  nodes[node].end = end;
+  if (const std::size_t parent = nodes[node].parent; parent != NONE)
+    nodes[parent].kinds |= nodes[node].kinds;
+}
+
+bool FlatTree::same_scope(const Search &s) const noexcept {
+  return s.includePath == includePath && s.recursive == recursive;
+}
+
+FlatTree::PathIters FlatTree::path(std::size_t node, std::size_t top) const {
+  assert(node == top || is_ancestor(top, node));
+  return std::make_pair(PathIter(this, node, top), PathIter(this, NONE, top));
+}
+
+bool FlatTree::is_conjunctive(std::size_t node, std::size_t top) const {
+  assert(node == top || is_ancestor(top, node));
+  const std::size_t breaks = nodes[node].breaks;
+  if (breaks != NONE && nodes[breaks].depth >= nodes[top].depth)
+    return false;
+  // a comprehension at the top isn't followed by a forall on the path
+  return !nodes[top].e->isa<MiniZinc::Comprehension>();
+}
+
+bool FlatTree::is_conjunctive(const PathIter &first, const PathIter &last) {
+  assert(last.node == NONE);
+  if (first.node == NONE)
+    return true;
+  return first.tree->is_conjunctive(first.node, first.top);
+}
+
+FlatTree::Context FlatTree::context(std::size_t node, std::size_t top) const {
+  assert(node == top || is_ancestor(top, node));
+  if (node == top)
+    return Context::conjunctive;
+  const std::size_t parent = nodes[node].parent;
+  if (is_conjunctive(parent, top))
+    return Context::conjunctive;
+  // the parity of the `not`s from `parent` up to `top`
+  const std::size_t above = nodes[top].parent;
+  const bool negated = nodes[parent].negated != (above != NONE && nodes[above].negated);
+  return negated ? Context::negated : Context::reified;
+}
+
+bool FlatTree::in_forall_body(std::size_t node, std::size_t top) const {
+  assert(node == top || is_ancestor(top, node));
+  // the closest one is the deepest, so none are below `top` if it isn't
+  const std::size_t comp = nodes[node].forall_comp;
+  return comp != NONE && is_ancestor(top, comp);
+}
+
+std::size_t FlatTree::index_of(const MiniZinc::Expression *e) const {
+  auto it = first_index.find(e);
+  return it == first_index.end() ? NONE : it->second;
+}
+
+std::pair<std::size_t, std::size_t> FlatTree::item_roots(std::size_t item) const {
+  assert(item < items.size());
+  const std::size_t end = item + 1 < items.size() ? items[item + 1].roots_begin : roots.size();
+  return std::make_pair(items[item].roots_begin, end);
+}
+
+void SearchHits::add(const MiniZinc::Item *item,
+                     const std::vector<const MiniZinc::Expression *> &captures, std::size_t node,
+                     std::size_t top) {
+  assert(captures.size() == numcaptures);
+  items.push_back(item);
+  caps.insert(caps.end(), captures.begin(), captures.end());
+  nodes.emplace_back(node, top);
+}
+
+void SearchHits::append(const SearchHits &other) {
+  assert(tree == other.tree && numcaptures == other.numcaptures);
+  items.insert(items.end(), other.items.begin(), other.items.end());
+  caps.insert(caps.end(), other.caps.begin(), other.caps.end());
+  nodes.insert(nodes.end(), other.nodes.begin(), other.nodes.end());
+}
+
+const MiniZinc::Item *SearchHits::item(std::size_t hit) const {
+  assert(hit < size());
+  return items[hit];
+}
+
+const MiniZinc::Expression *SearchHits::capture(std::size_t hit, std::size_t n) const {
+  assert(hit < size());
+  if (n >= numcaptures)
+    throw std::logic_error("n is larger than the number of captures");
+  return caps[hit * numcaptures + n];
+}
+
+SearchHits::PathIters SearchHits::path(std::size_t hit) const {
+  assert(hit < size());
+  const auto [node, top] = nodes[hit];
+  if (node == FlatTree::NONE)
+    return std::make_pair(FlatTree::PathIter(), FlatTree::PathIter());
+  return tree->path(node, top);
+}
+
+FlatTree::Context SearchHits::context(std::size_t hit) const {
+  assert(hit < size());
+  const auto [node, top] = nodes[hit];
+  assert(node != FlatTree::NONE);
+  return tree->context(node, top);
+}
+
+bool SearchHits::in_forall_body(std::size_t hit) const {
+  assert(hit < size());
+  const auto [node, top] = nodes[hit];
+  assert(node != FlatTree::NONE);
+  return tree->in_forall_body(node, top);
+}
+
+std::size_t MultiSearch::add(const Search &s) {
+  searches.push_back(&s);
+  return searches.size() - 1;
+}
+
+void MultiSearch::check_scope(const FlatTree &tree) const {
+  if (!std::all_of(searches.begin(), searches.end(),
+                   [&tree](const Search *s) { return tree.same_scope(*s); }))
+    throw std::logic_error("every search must have the same scope as the tree");
+}
+
+std::vector<SearchHits> MultiSearch::search(const FlatTree &tree) const {
+  check_scope(tree);
+  Impl::MultiSearcher searcher(searches, tree);
+  searcher.search_items();
+  return searcher.take_results();
+}
+
+std::vector<SearchHits> MultiSearch::search(const FlatTree &tree, std::size_t node) const {
+  assert(node < tree.size());
+  Impl::MultiSearcher searcher(searches, tree);
+  searcher.search_subtree(node);
+  return searcher.take_results();
+}
+
+std::vector<SearchHits> MultiSearch::search_parallel(const FlatTree &tree,
+                                                     unsigned int jobs) const {
+  if (jobs <= 1 || tree.num_items() <= 1)
+    return search(tree);
+  check_scope(tree);
+
+  // Split the items into chunks of roughly the same number of nodes. There are several chunks per
+  // thread, so that a thread that is done with its chunks can take the ones left by the others.
+  const std::size_t wanted_chunks = std::min<std::size_t>(tree.num_items(), jobs * 8);
+  const std::size_t chunk_size = tree.size() / wanted_chunks + 1;
+  std::vector<std::size_t> bounds = {0};
+  std::size_t chunk_nodes = 0;
+  for (std::size_t it = 0; it < tree.num_items(); ++it) {
+    const auto [roots_begin, roots_end] = tree.item_roots(it);
+    if (roots_begin == roots_end)
+      ++chunk_nodes;
+    else
+      chunk_nodes += tree.end(tree.root_node(roots_end - 1)) - tree.root_node(roots_begin);
+    if (chunk_nodes >= chunk_size) {
+      bounds.push_back(it + 1);
+      chunk_nodes = 0;
+    }
+  }
+  if (bounds.back() != tree.num_items())
+    bounds.push_back(tree.num_items());
+  const std::size_t num_chunks = bounds.size() - 1;
+
+  std::vector<std::vector<SearchHits>> chunk_hits(num_chunks);
+  std::atomic<std::size_t> next_chunk = 0;
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto work = [&]() {
+    try {
+      for (std::size_t c; (c = next_chunk++) < num_chunks;) {
+        Impl::MultiSearcher searcher(searches, tree);
+        searcher.search_items(bounds[c], bounds[c + 1]);
+        chunk_hits[c] = searcher.take_results();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error)
+        error = std::current_exception();
+      next_chunk = num_chunks;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const std::size_t num_threads = std::min<std::size_t>(jobs, num_chunks);
+  for (std::size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (error)
+    std::rethrow_exception(error);
+
+  std::vector<SearchHits> results = std::move(chunk_hits.front());
+  for (std::size_t c = 1; c < num_chunks; ++c) {
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      results[i].append(chunk_hits[c][i]);
+    }
+  }
+  return results;
+}
+
+NodeIndex::NodeIndex(const FlatTree &tree)
+    : tree(&tree),
+      by_id(MiniZinc::Expression::EID_END - MiniZinc::Expression::E_INTLIT + 1),
+      by_binop(MiniZinc::BOT_DOTDOT + 1), by_unop(MiniZinc::UOT_MINUS + 1) {
+  for (std::size_t idx = 0; idx < tree.size(); ++idx) {
+    const MiniZinc::Expression *e = tree.expr(idx);
+    by_id[e->eid() - MiniZinc::Expression::E_INTLIT].push_back(idx);
+    if (auto bo = e->dynamicCast<MiniZinc::BinOp>(); bo != nullptr)
+      by_binop[bo->op()].push_back(idx);
+    else if (auto uo = e->dynamicCast<MiniZinc::UnOp>(); uo != nullptr)
+      by_unop[uo->op()].push_back(idx);
+  }
+}
+
+bool NodeIndex::is_single_node(const Search &s) noexcept {
+  return s.nodes.size() == 1 && s.nodes.front().is_under() && s.global_filters.empty();
+}
+
+bool NodeIndex::can_answer(const Search &s) const noexcept {
+  return is_single_node(s) && tree->same_scope(s);
+}
+
+const std::vector<std::size_t> &NodeIndex::bucket(const Impl::SearchNode &node) const {
+  const auto &sub = node.target_subtype();
+  if (auto bot = std::get_if<MiniZinc::BinOpType>(&sub); bot != nullptr)
+    return by_binop[*bot];
+  if (auto uot = std::get_if<MiniZinc::UnOpType>(&sub); uot != nullptr)
+    return by_unop[*uot];
+  return by_id[node.target_id() - MiniZinc::Expression::E_INTLIT];
+}
+
+SearchHits NodeIndex::hits(const Search &s) const {
+  assert(can_answer(s));
+  SearchHits res(*tree, s.numcaptures);
+  std::vector<const MiniZinc::Expression *> captures;
+
+  const Impl::SearchNode &node = s.nodes.front();
+  const bool by_call_id = std::holds_alternative<Impl::SearchNode::CallIds>(node.target_subtype());
+  for (auto idx : bucket(node)) {
+    if (by_call_id && !node.match(tree->expr(idx)))
+      continue;
+    const std::size_t root = tree->root_of(idx);
+    const MiniZinc::Item *item = tree->item_of(idx);
+    const auto loc = tree->root_location(root);
+    if (item != nullptr &&
+        (!s.locations.should_visit(item) || (loc != nullptr && !(s.locations.*loc))))
+      continue;
+
+    captures.clear();
+    if (s.numcaptures > 0)
+      captures.push_back(tree->expr(idx));
+    res.add(item, captures, idx, tree->root_node(root));
+  }
+  return res;
+}
+
+bool Search::HitsSearcher::next() {
+  if (pos == NONE)
+    pos = 0;
+  else if (pos < hits->size())
+    ++pos;
+  return pos < hits->size();
+}
+
+const MiniZinc::Item *Search::HitsSearcher::cur_item() const noexcept {
+  if (pos == NONE || pos >= hits->size())
+    return nullptr;
+  return hits->item(pos);
+}
+
+const MiniZinc::Expression *Search::HitsSearcher::capture(std::size_t n) const {
+  assert(cur_item() != nullptr);
+  return hits->capture(pos, n);
+}
+
+void Search::HitsSearcher::skip_item() {
+  const MiniZinc::Item *item = cur_item();
+  if (item == nullptr)
+    return;
+  while (pos + 1 < hits->size() && hits->item(pos + 1) == item) {
+    ++pos;
+  }
+}
+
+SearchHits::PathIters Search::HitsSearcher::current_path() const {
+  assert(cur_item() != nullptr);
+  return hits->path(pos);
+}
+
+FlatTree::Context Search::HitsSearcher::context() const {
+  assert(cur_item() != nullptr);
+  return hits->context(pos);
+}
+
+bool Search::HitsSearcher::in_forall_body() const {
+  assert(cur_item() != nullptr);
+  return hits->in_forall_body(pos);
+}
+
 bool Search::ModelSearcher::next() {
   if (iters.empty())
     return false;
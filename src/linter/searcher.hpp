@@ -1,9 +1,14 @@
 #pragma once
 #include <minizinc/ast.hh>
 #include <minizinc/model.hh>
+#include <cstdint>
+#include <iterator>
 #include <optional>
 #include <stack>
+#include <string>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace LZN {
 
@@ -20,6 +25,9 @@ bool filter_global_comprehension_body(const MiniZinc::Expression *root,
 
 // forward reference
 class Search;
+class SearchHits;
+class NodeIndex;
+class FlatTree;
 
 } // namespace LZN
 
@@ -32,8 +40,39 @@ struct SearchLocs {
 
   bool should_visit(const MiniZinc::Item *i) const;
   bool any() const;
+  bool operator==(const SearchLocs &other) const noexcept;
+  std::size_t hash() const noexcept;
 };
 
+// A set of kinds of expressions: one bit for every `ExpressionId`, `BinOpType` and `UnOpType`.
+using KindSet = std::uint64_t;
+
+constexpr std::size_t NUM_EXPRESSION_IDS =
+    MiniZinc::Expression::EID_END - MiniZinc::Expression::E_INTLIT + 1;
+constexpr std::size_t NUM_BINOP_TYPES = MiniZinc::BOT_DOTDOT + 1;
+constexpr std::size_t NUM_UNOP_TYPES = MiniZinc::UOT_MINUS + 1;
+static_assert(NUM_EXPRESSION_IDS + NUM_BINOP_TYPES + NUM_UNOP_TYPES <= 64,
+              "every kind must fit in a KindSet");
+
+constexpr KindSet kind_bit(MiniZinc::Expression::ExpressionId eid) {
+  return KindSet(1) << (eid - MiniZinc::Expression::E_INTLIT);
+}
+constexpr KindSet kind_bit(MiniZinc::BinOpType bot) {
+  return KindSet(1) << (NUM_EXPRESSION_IDS + bot);
+}
+constexpr KindSet kind_bit(MiniZinc::UnOpType uot) {
+  return KindSet(1) << (NUM_EXPRESSION_IDS + NUM_BINOP_TYPES + uot);
+}
+// The kinds of `e`, its `ExpressionId` and its operator if it has one.
+KindSet kinds_of(const MiniZinc::Expression *e);
+
+// How an expression on a path affects whether the path is conjunctive, see `is_conjunctive`. A
+// comprehension only lets the path through if it is followed by a call to forall.
+enum class ConjunctiveLink { breaks, passes, comprehension };
+ConjunctiveLink conjunctive_link(const MiniZinc::Expression *e);
+// Returns true if `e` is a call to forall.
+bool is_forall(const MiniZinc::Expression *e);
+
 class SearchNode {
 public:
   enum class Attachement { direct, under };
@@ -41,11 +80,14 @@ public:
   using ExpressionId = MiniZinc::Expression::ExpressionId;
   using BinOpType = MiniZinc::BinOpType;
   using UnOpType = MiniZinc::UnOpType;
+  // The identifiers a call may have, any of them matches.
+  using CallIds = std::vector<MiniZinc::ASTString>;
+  using SubTarget = std::variant<std::monostate, BinOpType, UnOpType, CallIds>;
 
 private:
   Attachement att;
   ExpressionId target;
-  std::variant<std::monostate, BinOpType, UnOpType> sub_target;
+  SubTarget sub_target;
   bool be_captured;
   std::optional<ExprFilterFun> filter_fun;
 
@@ -58,14 +100,24 @@ public:
   SearchNode(Attachement attachement, UnOpType un_target, bool be_captured = false)
       : att(attachement), target(ExpressionId::E_UNOP), sub_target(un_target),
         be_captured(be_captured) {}
+  SearchNode(Attachement attachement, CallIds call_ids, bool be_captured = false)
+      : att(attachement), target(ExpressionId::E_CALL), sub_target(std::move(call_ids)),
+        be_captured(be_captured) {}
 
   bool match(const MiniZinc::Expression *) const;
+  ExpressionId target_id() const noexcept { return target; }
+  const SubTarget &target_subtype() const noexcept { return sub_target; }
   bool capturable() const noexcept { return be_captured; }
   void capturable(bool b) noexcept { be_captured = b; }
   bool is_direct() const noexcept { return att == Attachement::direct; }
   bool is_under() const noexcept { return !is_direct(); }
   void filter(ExprFilterFun f) noexcept { filter_fun = f; }
   bool run_filter(const MiniZinc::Expression *p, const MiniZinc::Expression *child) const;
+  // The kinds an expression must have to be matched.
+  KindSet kinds() const noexcept;
+  bool operator==(const SearchNode &other) const noexcept;
+  // A hash that is equal for equal nodes.
+  std::size_t hash() const noexcept;
 };
 
 class ExprSearcher {
@@ -74,6 +126,7 @@ class ExprSearcher {
   std::vector<const MiniZinc::Expression *> path;
   std::vector<const MiniZinc::Expression *> dfs_stack;
   std::vector<const MiniZinc::Expression *> hits; // TODO: heap allocated array instead?
+  std::vector<std::size_t> captured;               // the indices of the captured `nodes`
   std::size_t nodes_pos;
 
 public:
@@ -82,6 +135,10 @@ public:
       : nodes(nodes), global_filters(global_filters), nodes_pos(0) {
     assert(!nodes.empty());
     hits.reserve(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      if (nodes[i].capturable())
+        captured.push_back(i);
+    }
   }
   bool has_result() const noexcept;
   bool is_searching() const noexcept;
@@ -126,10 +183,198 @@ protected:
   ExprSearcher::PathIters current_path() const;
 };
 
+// forward reference, see `LZN::MultiSearch`.
+class MultiSearcher;
+
 } // namespace LZN::Impl
 
 namespace LZN {
 
+// A read-only, flattened view of the expressions of a model. Every expression tree a search could
+// start in, called a root, is stored in preorder. The descendants of node `i` are therefore the
+// nodes in `[i + 1, end(i))` and questions about ancestry are answered with index arithmetic.
+class FlatTree {
+public:
+  static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+  // Iterates over a path, from a node up to one of its ancestors, both included.
+  class PathIter {
+    friend FlatTree;
+
+    const FlatTree *tree = nullptr;
+    std::size_t node = NONE;
+    std::size_t top = NONE;
+
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = const MiniZinc::Expression *;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = value_type;
+
+    PathIter() = default;
+    PathIter(const FlatTree *tree, std::size_t node, std::size_t top)
+        : tree(tree), node(node), top(top) {}
+
+    value_type operator*() const { return tree->expr(node); }
+    PathIter &operator++();
+    PathIter operator++(int) {
+      PathIter old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const PathIter &other) const noexcept { return node == other.node; }
+    bool operator!=(const PathIter &other) const noexcept { return !(*this == other); }
+  };
+  using PathIters = std::pair<PathIter, PathIter>;
+
+  // Where the value of a node ends up: constrained to be true, under an odd number of `not` or
+  // anything else.
+  enum class Context { conjunctive, negated, reified };
+
+private:
+  struct Node {
+    const MiniZinc::Expression *e;
+    std::size_t parent;      // `NONE` for roots
+    std::size_t end;         // one past the last descendant
+    std::size_t depth;       // 0 for roots
+    std::size_t root;        // index into `roots`
+    Impl::KindSet kinds;     // the kinds of every node in the subtree
+    std::size_t breaks;      // the first node on the path from this one up to the root that
+                             // isn't conjunctive, `NONE` if they all are
+    std::size_t forall_comp; // the closest comprehension given to forall whose body this node is
+                             // in, `NONE` if there is none
+    bool negated;            // whether there is an odd number of `not` from this node to the root
+  };
+  struct Root {
+    const MiniZinc::Item *item;  // nullptr if the tree is of a single expression
+    bool Impl::SearchLocs::*loc; // where in `item` the root is, nullptr if that is decided by
+                                 // the kind of item alone.
+    std::size_t node;
+  };
+  struct ItemEntry {
+    const MiniZinc::Item *item;
+    std::size_t roots_begin; // the roots of the item end where the ones of the next item begin
+  };
+
+  const std::vector<std::string> *includePath = nullptr;
+  bool recursive = false;
+  std::vector<ItemEntry> items; // in the order a `ModelSearcher` visits them
+  std::vector<Root> roots;
+  std::vector<Node> nodes;
+  std::unordered_map<const MiniZinc::Expression *, std::size_t> first_index;
+
+public:
+  // Flatten all items in `m` that `scope` doesn't ignore, i.e. only user defined items if `scope`
+  // is user defined only, and included models if `scope` is recursive. The locations and nodes of
+  // `scope` are not used.
+  FlatTree(const MiniZinc::Model *m, const Search &scope);
+  // Flatten a single expression, without any items.
+  explicit FlatTree(const MiniZinc::Expression *e);
+
+  // Returns true if `s` ignores and includes the same items as this tree.
+  bool same_scope(const Search &s) const noexcept;
+
+  // The number of nodes.
+  std::size_t size() const noexcept { return nodes.size(); }
+  const MiniZinc::Expression *expr(std::size_t node) const { return nodes[node].e; }
+  std::size_t parent(std::size_t node) const { return nodes[node].parent; }
+  std::size_t end(std::size_t node) const { return nodes[node].end; }
+  std::size_t depth(std::size_t node) const { return nodes[node].depth; }
+  // Returns true if `anc` is a strict ancestor of `node`.
+  bool is_ancestor(std::size_t anc, std::size_t node) const {
+    return anc < node && node < nodes[anc].end;
+  }
+  // The kinds of every node in the subtree of `node`, including itself.
+  Impl::KindSet subtree_kinds(std::size_t node) const { return nodes[node].kinds; }
+  // Returns true if the subtree of `node` contains every kind in `ks`, i.e. if something
+  // that needs all of them could possibly be found there.
+  bool may_contain(std::size_t node, Impl::KindSet ks) const {
+    return (nodes[node].kinds & ks) == ks;
+  }
+  // Call `f(child)` for every child of `node`, in preorder.
+  template <typename F>
+  void for_each_child(std::size_t node, F f) const {
+    for (std::size_t c = node + 1; c < nodes[node].end; c = nodes[c].end) {
+      f(c);
+    }
+  }
+  // The path from `node` up to its ancestor `top`.
+  PathIters path(std::size_t node, std::size_t top) const;
+  // Returns true if the path from `node` up to its ancestor `top` is conjunctive, the same as
+  // `is_conjunctive` but without walking the path.
+  bool is_conjunctive(std::size_t node, std::size_t top) const;
+  // Same as above, for the rest of a path from `first`. `last` must be the end of the path.
+  static bool is_conjunctive(const PathIter &first, const PathIter &last);
+  // The context of `node` in the subtree of its ancestor `top`, given by the path from the
+  // parent of `node` up to `top`. `top` itself is conjunctive.
+  Context context(std::size_t node, std::size_t top) const;
+  // Returns true if `node` is in the body of a comprehension given to forall, where both are in
+  // the subtree of `top`.
+  bool in_forall_body(std::size_t node, std::size_t top) const;
+  // The first node of `e`, or `NONE` if it isn't in the tree.
+  std::size_t index_of(const MiniZinc::Expression *e) const;
+
+  // The number of items, and the item number `item`.
+  std::size_t num_items() const noexcept { return items.size(); }
+  const MiniZinc::Item *item(std::size_t item) const { return items[item].item; }
+  // The range of roots of item number `item`.
+  std::pair<std::size_t, std::size_t> item_roots(std::size_t item) const;
+  // The node of root number `root`, and where in its item it is.
+  std::size_t root_node(std::size_t root) const { return roots[root].node; }
+  bool Impl::SearchLocs::*root_location(std::size_t root) const { return roots[root].loc; }
+  // The root `node` belongs to, and the item it is in.
+  std::size_t root_of(std::size_t node) const { return nodes[node].root; }
+  const MiniZinc::Item *item_of(std::size_t node) const { return roots[nodes[node].root].item; }
+
+private:
+  void flatten_model(const MiniZinc::Model *m, const Search &scope);
+  void flatten(const MiniZinc::Expression *root, const MiniZinc::Item *item,
+               bool Impl::SearchLocs::*loc);
+  // Set the depth and the context of `node`, which will get the index `idx`, from its parent.
+  void set_context(Node &node, std::size_t idx) const;
+  // Set the end of `node`, once its whole subtree is flattened.
+  void close(std::size_t node, std::size_t end);
+};
+
+// The hits of a search in a `FlatTree`, stored flat one after the other so that they can be
+// iterated again without searching. See `MultiSearch` and `Search::HitsSearcher`.
+class SearchHits {
+  const FlatTree *tree;
+  std::size_t numcaptures;                         // The number of captures per hit
+  std::vector<const MiniZinc::Item *> items;       // The item each hit was found in
+  std::vector<const MiniZinc::Expression *> caps;  // `numcaptures` captures per hit
+  std::vector<std::pair<std::size_t, std::size_t>> // The node of each hit and the node the search
+      nodes;                                       // started in, `NONE` for items only searches
+
+public:
+  using PathIters = FlatTree::PathIters;
+
+  SearchHits(const FlatTree &tree, std::size_t numcaptures)
+      : tree(&tree), numcaptures(numcaptures) {}
+
+  // Add a hit. `captures` must contain exactly `num_captures()` expressions. The path of the hit
+  // goes from `node` up to `top`, both are `FlatTree::NONE` if the search is for items only.
+  void add(const MiniZinc::Item *item, const std::vector<const MiniZinc::Expression *> &captures,
+           std::size_t node, std::size_t top);
+  // Add every hit of `other`, which must be of the same tree and have as many captures.
+  void append(const SearchHits &other);
+
+  std::size_t size() const noexcept { return items.size(); }
+  bool empty() const noexcept { return items.empty(); }
+  std::size_t num_captures() const noexcept { return numcaptures; }
+  // The item hit number `hit` was found in
+  const MiniZinc::Item *item(std::size_t hit) const;
+  // The n:th capture of hit number `hit`
+  const MiniZinc::Expression *capture(std::size_t hit, std::size_t n) const;
+  // A pair of iterators over the path of hit number `hit`, from the hit to the root.
+  PathIters path(std::size_t hit) const;
+  // The context of hit number `hit` where its search started, see `FlatTree::context`.
+  FlatTree::Context context(std::size_t hit) const;
+  // Returns true if hit number `hit` is in the body of a forall, see `FlatTree::in_forall_body`.
+  bool in_forall_body(std::size_t hit) const;
+};
+
 // A built search object, ready to perform searches.
 class Search {
   std::vector<Impl::SearchNode> nodes; // The path to search for
@@ -149,6 +394,9 @@ class Search {
 
   friend class SearchBuilder;
   friend class Impl::ModelSearcher;
+  friend class Impl::MultiSearcher;
+  friend class NodeIndex;
+  friend class FlatTree;
 
 public:
   // A searcher to search top-level items in a model.
@@ -185,7 +433,8 @@ public:
                        const std::vector<ExprFilterFun> *global_filters,
                        const MiniZinc::Expression *e)
         : Impl::ExprSearcher(nodes, global_filters) {
-      new_search(e);
+      if (e != nullptr)
+        new_search(e);
     }
 
   public:
@@ -193,6 +442,9 @@ public:
     using Impl::ExprSearcher::current_path;
     // Search for the next hit, returns true if one is found
     bool next() { return Impl::ExprSearcher::next(); }
+    // Abort the current search and start over in `e`. Keeps the allocated memory, so searching
+    // many expressions one after the other with a single searcher doesn't allocate anything.
+    void reset(const MiniZinc::Expression *e) { new_search(e); }
     // Returns the n:th captured node
     const MiniZinc::Expression *capture(std::size_t n) const {
       return Impl::ExprSearcher::capture(n);
@@ -204,6 +456,79 @@ public:
     }
   };
 
+  // A searcher over the stored hits of a model search, see `SearchHits`. Has the same interface as
+  // `ModelSearcher`.
+  class HitsSearcher {
+    const SearchHits *hits;
+    std::size_t pos; // The current hit, `NONE` if `next` hasn't been called yet
+
+    static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+  public:
+    explicit HitsSearcher(const SearchHits &hits) : hits(&hits), pos(NONE) {}
+
+    // Step to the next hit, returns true if there is one
+    bool next();
+    // Returns the item where the current hit was found in
+    const MiniZinc::Item *cur_item() const noexcept;
+    // Returns the n:th captured node
+    const MiniZinc::Expression *capture(std::size_t n) const;
+    // Skip the rest of the hits in the current item
+    void skip_item();
+    // Returns a pair of iterators for the path of the current hit
+    SearchHits::PathIters current_path() const;
+    // The context of the current hit, see `SearchHits::context`
+    FlatTree::Context context() const;
+    // Returns true if the current hit is in the body of a comprehension given to forall
+    bool in_forall_body() const;
+
+    // Convenience to capture and cast at the same time.
+    template <typename T>
+    const T *capture_cast(std::size_t n) const {
+      return capture(n)->cast<T>();
+    }
+  };
+
+  // A searcher for a range of expressions, searched one after the other with a single
+  // `ExpressionSearcher`.
+  template <typename It>
+  class ExpressionsSearcher {
+    friend Search;
+
+    ExpressionSearcher searcher;
+    It cur, last;
+
+    ExpressionsSearcher(ExpressionSearcher searcher, It first, It last)
+        : searcher(std::move(searcher)), cur(first), last(last) {}
+
+  public:
+    // Search for the next hit, in the current expression or in the following ones. Returns true
+    // if one is found.
+    bool next() {
+      while (cur != last) {
+        if (searcher.next())
+          return true;
+        if (++cur != last)
+          searcher.reset(*cur);
+      }
+      return false;
+    }
+    // Skip the rest of the current expression, the next hit is searched for in the following one.
+    void skip_root() {
+      if (cur != last && ++cur != last)
+        searcher.reset(*cur);
+    }
+    // The expression the current hit is in
+    const MiniZinc::Expression *root() const { return *cur; }
+    // Same as in `ExpressionSearcher`
+    auto current_path() const { return searcher.current_path(); }
+    const MiniZinc::Expression *capture(std::size_t n) const { return searcher.capture(n); }
+    template <typename T>
+    const T *capture_cast(std::size_t n) const {
+      return searcher.template capture_cast<T>(n);
+    }
+  };
+
   // Search among top-level items in a model.
   ModelSearcher search(const MiniZinc::Model *m) const & { return ModelSearcher(m, *this); }
   ModelSearcher search(const MiniZinc::Model *) && = delete;
@@ -212,12 +537,82 @@ public:
     return ExpressionSearcher(nodes, &global_filters, e);
   }
   ExpressionSearcher search(const MiniZinc::Expression *) && = delete;
+  // Search every expression in `[first, last)`, in order.
+  template <typename It>
+  ExpressionsSearcher<It> search(It first, It last) const & {
+    ExpressionSearcher searcher(nodes, &global_filters, first != last ? *first : nullptr);
+    return ExpressionsSearcher<It>(std::move(searcher), first, last);
+  }
+  template <typename It>
+  ExpressionsSearcher<It> search(It, It) && = delete;
 
   // Returns true if an include-statement includes a non-library model.
   bool is_user_defined_include(const MiniZinc::IncludeI *) const noexcept;
   bool is_recursive() const noexcept;
   bool is_user_defined_only() const noexcept { return includePath != nullptr; }
   const std::vector<std::string> *include_path() const noexcept { return includePath; };
+  std::size_t num_captures() const noexcept { return numcaptures; }
+
+  // Two searches are equal if they would find the exact same hits.
+  bool operator==(const Search &other) const noexcept;
+  bool operator!=(const Search &other) const noexcept { return !(*this == other); }
+  // A hash that is equal for equal searches, made from all of their nodes, locations, filters and
+  // include settings.
+  std::size_t hash() const noexcept;
+};
+
+// Performs several searches in one single traversal of a `FlatTree`. Each node is visited at most
+// once, no matter how many searches are added, and subtrees where no search can match anything
+// are skipped.
+//
+// The hits of each search are the same as if it had been performed by itself using
+// `Search::search`, but the order of the hits within an expression might differ.
+class MultiSearch {
+  std::vector<const Search *> searches;
+
+  void check_scope(const FlatTree &tree) const;
+
+public:
+  // Add a search and return its index among the results of `search`. `s` must outlive this object.
+  std::size_t add(const Search &s);
+  std::size_t size() const noexcept { return searches.size(); }
+
+  // Search all items in `tree` and return the hits of every added search, in the order they were
+  // added. Every search must have the same scope as `tree`, see `FlatTree::same_scope`. The hits
+  // refer to `tree`, which must outlive them.
+  std::vector<SearchHits> search(const FlatTree &tree) const;
+  // Search the subtree of `node` only, like `Search::search` does with an expression. The
+  // locations of the searches are not used.
+  std::vector<SearchHits> search(const FlatTree &tree, std::size_t node) const;
+  // Same as `search(tree)`, but the items are shared between `jobs` threads. The hits are the same
+  // and in the same order. Everything the searches run, such as filters, must be safe to run in
+  // several threads at once.
+  std::vector<SearchHits> search_parallel(const FlatTree &tree, unsigned int jobs) const;
+};
+
+// An index of every node in a `FlatTree`, grouped by kind (`ExpressionId`, `BinOpType` and
+// `UnOpType`). It can answer searches for a single `under` node, i.e. searches that only list every
+// node of one kind, by scanning the nodes of that kind instead of searching the tree. A node for
+// calls with certain identifiers scans every call.
+class NodeIndex {
+  const FlatTree *tree;
+  std::vector<std::vector<std::size_t>> by_id, by_binop, by_unop; // nodes in preorder
+
+public:
+  // `tree` must outlive the index.
+  explicit NodeIndex(const FlatTree &tree);
+
+  // Returns true if `s` is a search for a single `under` node without global filters.
+  static bool is_single_node(const Search &s) noexcept;
+  // Returns true if `s` can be answered by `hits`, i.e. if it is a single node search with the
+  // same scope as the tree.
+  bool can_answer(const Search &s) const noexcept;
+  // The hits of `s`, which must be answerable. The hits are in the same order as `MultiSearch`
+  // would find them.
+  SearchHits hits(const Search &s) const;
+
+private:
+  const std::vector<std::size_t> &bucket(const Impl::SearchNode &node) const;
 };
 
 // A builder for `Search`
@@ -334,6 +729,14 @@ public:
     nodes.emplace_back(Attach::direct, uot);
     return *this;
   }
+  // A call with identifier `call_id`, or with any of `call_ids`.
+  SearchBuilder &direct(const MiniZinc::ASTString &call_id) {
+    return direct(std::vector<MiniZinc::ASTString>{call_id});
+  }
+  SearchBuilder &direct(std::vector<MiniZinc::ASTString> call_ids) {
+    nodes.emplace_back(Attach::direct, std::move(call_ids));
+    return *this;
+  }
 
   // Add a type of node to search for. It is a child (non-direct) of the previous node, if any.
   SearchBuilder &under(ExpressionId eid) {
@@ -348,6 +751,13 @@ public:
     nodes.emplace_back(Attach::under, uot);
     return *this;
   }
+  SearchBuilder &under(const MiniZinc::ASTString &call_id) {
+    return under(std::vector<MiniZinc::ASTString>{call_id});
+  }
+  SearchBuilder &under(std::vector<MiniZinc::ASTString> call_ids) {
+    nodes.emplace_back(Attach::under, std::move(call_ids));
+    return *this;
+  }
 
   // Specify that the latest node (`direct` or `under`) should be captured, i.e. saved for retrieval
   // later.
@@ -366,3 +776,10 @@ public:
   }
 };
 } // namespace LZN
+
+namespace std {
+template <>
+struct hash<LZN::Search> {
+  std::size_t operator()(const LZN::Search &s) const noexcept { return s.hash(); }
+};
+} // namespace std
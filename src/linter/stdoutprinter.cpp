@@ -235,4 +235,8 @@ void stdout_print(const std::vector<LintResult> &results) {
     print_one_result(r, reader);
   }
 }
+
+void stdout_print_heading(const std::string &model) {
+  std::cout << rang::style::bold << "==> " << model << " <==" << rang::style::reset << std::endl;
+}
 } // namespace LZN
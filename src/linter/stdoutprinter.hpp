@@ -1,9 +1,12 @@
 #pragma once
 
 #include <linter/rules.hpp>
+#include <string>
 #include <vector>
 
 namespace LZN {
 // Print all results in `results` to stdout with pretty colors.
 void stdout_print(const std::vector<LintResult> &results);
+// Print a heading for the results of `model`, when the results of several models are printed.
+void stdout_print_heading(const std::string &model);
 } // namespace LZN
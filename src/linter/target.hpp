@@ -0,0 +1,15 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace LZN {
+
+// A model to lint together with its data files.
+struct LintTarget {
+  std::string model;
+  std::vector<std::string> datafiles;
+  std::optional<std::string> contents; // the text of `model` if it isn't to be read from the file
+};
+
+} // namespace LZN
@@ -1,4 +1,5 @@
 #include "utils.hpp"
+#include <unordered_map>
 
 namespace LZN {
 
@@ -9,11 +10,6 @@ const MiniZinc::Expression *follow_id_to_decl(const MiniZinc::Expression *e) {
   return MiniZinc::follow_id_to_decl(const_cast<MiniZinc::Expression *>(e));
 }
 
-MiniZinc::IntBounds compute_int_bounds(MiniZinc::EnvI &env, const MiniZinc::Expression *e) {
-  // NOTE: doesn't modify `e` I think
-  return MiniZinc::compute_int_bounds(env, const_cast<MiniZinc::Expression *>(e));
-}
-
 bool is_int_expr(const MiniZinc::Expression *e, long long int i) {
   assert(e != nullptr);
   if (auto intlit = e->dynamicCast<MiniZinc::IntLit>(); intlit != nullptr) {
@@ -30,26 +26,6 @@ bool is_float_expr(const MiniZinc::Expression *e, double f) {
   return false;
 }
 
-bool depends_on_instance(const MiniZinc::Expression *e) {
-  if (e == nullptr)
-    return false;
-  // TODO: implement using EVisitor instead
-  static const auto s = SearchBuilder().under(MiniZinc::Expression::E_ID).capture().build();
-  auto ms = s.search(e);
-  while (ms.next()) {
-    auto id = ms.capture_cast<MiniZinc::Id>(0);
-    // TODO: include pars in let-statements as well
-    if (id->type().isPar() && id->decl() != nullptr && id->decl()->toplevel()) {
-      return true;
-    }
-    // TODO: check declaration for array accesses
-    // TODO: follow a chain of variables if `id` is set to another variable
-    if (id->decl() != nullptr && depends_on_instance(id->decl()->ti()->domain()))
-      return true;
-  }
-  return false;
-}
-
 const MiniZinc::Expression *other_side(const MiniZinc::BinOp *parent,
                                        const MiniZinc::Expression *side) {
   assert(parent != nullptr);
@@ -77,19 +53,28 @@ bool is_array_access_simple(const MiniZinc::ArrayAccess *access) {
 
 bool comprehension_covers_whole_array(const MiniZinc::Comprehension *comp,
                                       const MiniZinc::VarDecl *array) {
-  auto array_domains = array->ti()->ranges();
-  std::vector<const MiniZinc::Expression *> comp_domains;
+  // The index sets of `array` by their structural hash. Every generator variable must take one of
+  // them, only the ones with the same hash are compared.
+  auto hash = [](const MiniZinc::Expression *e) -> std::size_t {
+    return e != nullptr ? e->hash() : 0;
+  };
+  std::unordered_multimap<std::size_t, const MiniZinc::Expression *> array_domains;
+  for (auto r : array->ti()->ranges()) {
+    array_domains.emplace(hash(r->domain()), r->domain());
+  }
   for (unsigned int gen = 0; gen < comp->numberOfGenerators(); ++gen) {
     auto in = comp->in(gen);
     for (unsigned int i = 0; i < comp->numberOfDecls(gen); ++i) {
-      comp_domains.push_back(in);
+      auto [first, last] = array_domains.equal_range(hash(in));
+      auto match = std::find_if(first, last, [in](const auto &domain) {
+        return MiniZinc::Expression::equal(in, domain.second);
+      });
+      if (match == last)
+        return false;
+      array_domains.erase(match);
     }
   }
-  return unsorted_equal_cmp(comp_domains.begin(), comp_domains.end(), array_domains.begin(),
-                            array_domains.end(),
-                            [](const MiniZinc::Expression *c, const MiniZinc::TypeInst *a) {
-                              return MiniZinc::Expression::equal(c, a->domain());
-                            });
+  return array_domains.empty();
 }
 
 bool comprehension_contains_where(const MiniZinc::Comprehension *comp) {
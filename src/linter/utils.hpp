@@ -1,5 +1,6 @@
 #pragma once
 #include <algorithm>
+#include <linter/pattern.hpp>
 #include <linter/searcher.hpp>
 #include <minizinc/ast.hh>
 #include <minizinc/eval_par.hh>
@@ -34,15 +35,11 @@ bool unsorted_equal_cmp(ItModify modbeg, ItModify modend, It beg, It end, Cmp cm
 // These assume that the original functions in "eval_par.hh" doesn't modify their arguments.
 const MiniZinc::Expression *follow_id(const MiniZinc::Expression *e);
 const MiniZinc::Expression *follow_id_to_decl(const MiniZinc::Expression *e);
-MiniZinc::IntBounds compute_int_bounds(MiniZinc::EnvI &env, const MiniZinc::Expression *e);
 
 // Check wheter the expression is an IntLit with some value
 bool is_int_expr(const MiniZinc::Expression *e, long long int i);
 bool is_float_expr(const MiniZinc::Expression *e, double f);
 
-// Check if e contains any top-level parameters
-bool depends_on_instance(const MiniZinc::Expression *e);
-
 // Return a pointer to the other side of a binary operation given one of its sides
 const MiniZinc::Expression *other_side(const MiniZinc::BinOp *parent,
                                        const MiniZinc::Expression *side);
@@ -80,114 +77,83 @@ bool is_conjunctive(T b, T e) {
                      [&last_comp](const MiniZinc::Expression *e) {
                        if (last_comp) {
                          last_comp = false;
-                         auto call = e->dynamicCast<MiniZinc::Call>();
-                         return call != nullptr && call->id() == MiniZinc::constants().ids.forall;
-                       }
-                       if (auto bo = e->dynamicCast<MiniZinc::BinOp>(); bo != nullptr) {
-                         return bo->op() == MiniZinc::BinOpType::BOT_AND;
-                       }
-                       if (e->isa<MiniZinc::Let>()) {
-                         return true;
-                       }
-                       if (auto call = e->dynamicCast<MiniZinc::Call>(); call != nullptr) {
-                         const auto &id = call->id();
-                         const auto &conts = MiniZinc::constants().ids;
-                         return strcmp(id.c_str(), "implied_constraint") == 0 ||
-                                id == conts.assert || id == conts.mzn_redundant_constraint ||
-                                id == conts.mzn_symmetry_breaking_constraint;
+                         return Impl::is_forall(e);
                        }
-                       if (auto ite = e->dynamicCast<MiniZinc::ITE>(); ite != nullptr) {
-                         for (unsigned int i = 0; i < ite->size(); i++) {
-                           if (ite->ifExpr(i)->type().isvar())
-                             return false;
-                         }
-                         return true;
-                       }
-                       if (auto comp = e->dynamicCast<MiniZinc::Comprehension>(); comp != nullptr) {
-                         last_comp = true;
-                         return true;
+                       switch (Impl::conjunctive_link(e)) {
+                       case Impl::ConjunctiveLink::passes: return true;
+                       case Impl::ConjunctiveLink::comprehension: last_comp = true; return true;
+                       case Impl::ConjunctiveLink::breaks: return false;
                        }
                        return false;
                      }) &&
          !last_comp;
 }
 
-inline const Search EQUAL_CONSTRAINED_VARIABLES =
-    SearchBuilder()
-        .global_filter(filter_out_annotations)
-        .global_filter(filter_global_comprehension_body)
-        .under(MiniZinc::BinOpType::BOT_EQ)
-        .capture()
-        .direct(MiniZinc::Expression::E_ID)
-        .capture()
-        .build();
-
-// find all functionally defined variables in `e` of the form: var=..
+// Same as above for a path in a `FlatTree`, which is answered without walking the path. `e` must
+// be the end of the path.
+inline bool is_conjunctive(FlatTree::PathIter b, FlatTree::PathIter e) {
+  return FlatTree::is_conjunctive(b, e);
+}
+
+using EqualConstrainedVariables =
+    Pattern<GlobalFilters<filter_out_annotations, filter_global_comprehension_body>,
+            Under<MiniZinc::BinOpType::BOT_EQ, Capture>,
+            Direct<MiniZinc::Expression::E_ID, Capture>>;
+
+// find all functionally defined variables in the subtree of `node` of the form: var=..
 template <typename T>
-void equal_constrained_variables(const MiniZinc::Expression *e, T inserter) {
-  assert(e != nullptr);
-  auto ms = EQUAL_CONSTRAINED_VARIABLES.search(e);
-
-  while (ms.next()) {
-    auto [pathbegin, pathend] = ms.current_path();
-    for (int i = 0; i < 2; ++i) {
-      assert(pathbegin != pathend);
-      ++pathbegin;
-    }
-    if (!is_conjunctive(pathbegin, pathend))
-      continue;
+void equal_constrained_variables(const FlatTree &tree, std::size_t node, T inserter) {
+  EqualConstrainedVariables::search(
+      tree, node, [&inserter](const EqualConstrainedVariables::Hit &hit, FlatTree::PathIters path) {
+        auto [pathbegin, pathend] = path;
+        for (int i = 0; i < 2; ++i) {
+          assert(pathbegin != pathend);
+          ++pathbegin;
+        }
+        if (!is_conjunctive(pathbegin, pathend))
+          return;
 
-    auto eq = ms.capture(0)->cast<MiniZinc::BinOp>();
-    auto id = ms.capture(1)->cast<MiniZinc::Id>();
-    std::invoke(inserter, eq, id);
-  }
+        auto [eq, id] = hit;
+        std::invoke(inserter, eq, id);
+      });
 }
 
-inline const Search EQUAL_CONSTRAINED_ACCESS // force clang-format to break here
-    = SearchBuilder()
-          .global_filter(filter_global_comprehension_body)
-          .under(MiniZinc::BinOpType::BOT_EQ)
-          .capture()
-          .direct(MiniZinc::Expression::E_ARRAYACCESS)
-          .capture()
-          .filter(filter_arrayaccess_name)
-          .direct(MiniZinc::Expression::E_ID)
-          .capture()
-          .build();
+using EqualConstrainedAccess =
+    Pattern<GlobalFilters<filter_global_comprehension_body>,
+            Under<MiniZinc::BinOpType::BOT_EQ, Capture>,
+            Direct<MiniZinc::Expression::E_ARRAYACCESS, Capture, Filter<filter_arrayaccess_name>>,
+            Direct<MiniZinc::Expression::E_ID, Capture>>;
 
 // find all a[..] = ..
 // and forall([..|a[..] = ..])
+// in the subtree of `node`
 template <typename T>
-void equal_constrained_access(const MiniZinc::Expression *e, T inserter) {
-  assert(e != nullptr);
-  auto ms = EQUAL_CONSTRAINED_ACCESS.search(e);
-
-  while (ms.next()) {
-    auto [pathbegin, pathend] = ms.current_path();
-    for (int i = 0; i < 3; ++i) {
-      assert(pathbegin != pathend);
-      ++pathbegin;
-    }
-    if (!is_conjunctive(pathbegin, pathend))
-      continue;
-
-    const MiniZinc::Comprehension *comp = nullptr;
-    for (int i = 0; i < 2 && pathbegin != pathend; ++pathbegin, ++i) {
-      if (i == 0) {
-        comp = (*pathbegin)->dynamicCast<MiniZinc::Comprehension>();
-      } else {
-        auto call = (*pathbegin)->dynamicCast<MiniZinc::Call>();
-        if (call == nullptr || call->id() != MiniZinc::constants().ids.forall) {
-          comp = nullptr;
+void equal_constrained_access(const FlatTree &tree, std::size_t node, T inserter) {
+  EqualConstrainedAccess::search(
+      tree, node, [&inserter](const EqualConstrainedAccess::Hit &hit, FlatTree::PathIters path) {
+        auto [pathbegin, pathend] = path;
+        for (int i = 0; i < 3; ++i) {
+          assert(pathbegin != pathend);
+          ++pathbegin;
+        }
+        if (!is_conjunctive(pathbegin, pathend))
+          return;
+
+        const MiniZinc::Comprehension *comp = nullptr;
+        for (int i = 0; i < 2 && pathbegin != pathend; ++pathbegin, ++i) {
+          if (i == 0) {
+            comp = (*pathbegin)->dynamicCast<MiniZinc::Comprehension>();
+          } else {
+            auto call = (*pathbegin)->dynamicCast<MiniZinc::Call>();
+            if (call == nullptr || call->id() != MiniZinc::constants().ids.forall) {
+              comp = nullptr;
+            }
+          }
         }
-      }
-    }
 
-    const auto eq = ms.capture_cast<MiniZinc::BinOp>(0);
-    const auto access = ms.capture_cast<MiniZinc::ArrayAccess>(1);
-    const auto id = ms.capture_cast<MiniZinc::Id>(2);
-    const MiniZinc::Expression *rhs = other_side(eq, access);
-    std::invoke(inserter, eq, access, id, rhs, comp);
-  }
+        const auto [eq, access, id] = hit;
+        const MiniZinc::Expression *rhs = other_side(eq, access);
+        std::invoke(inserter, eq, access, id, rhs, comp);
+      });
 }
 } // namespace LZN
@@ -0,0 +1,338 @@
+#include "lsp.hpp"
+#include "lint.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <linter/json.hpp>
+#include <linter/lsp_utils.hpp>
+#include <map>
+#include <poll.h>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+using namespace LZN;
+using Clock = std::chrono::steady_clock;
+
+// How long to wait after a change before linting, more changes in the meantime restart the wait.
+constexpr std::chrono::milliseconds RELINT_DELAY(300);
+
+// JSON-RPC error codes
+constexpr int METHOD_NOT_FOUND = -32601;
+constexpr int INVALID_REQUEST = -32600;
+
+constexpr int SEVERITY_ERROR = 1;
+constexpr int SEVERITY_WARNING = 2;
+
+// The line and character of an LSP position, nullopt if it isn't one.
+std::optional<std::pair<double, double>> line_character(const Json *pos) {
+  if (pos == nullptr)
+    return std::nullopt;
+  auto line = pos->get("line");
+  auto character = pos->get("character");
+  if (line == nullptr || character == nullptr || line->number() == nullptr ||
+      character->number() == nullptr)
+    return std::nullopt;
+  return std::make_pair(*line->number(), *character->number());
+}
+
+// Returns true if the ranges `a` and `b` overlap or touch.
+bool ranges_meet(const Json &a, const Json &b) {
+  auto a_start = line_character(a.get("start")), a_end = line_character(a.get("end"));
+  auto b_start = line_character(b.get("start")), b_end = line_character(b.get("end"));
+  if (!a_start || !a_end || !b_start || !b_end)
+    return false;
+  return !(*a_end < *b_start || *b_end < *a_start);
+}
+
+class LspServer {
+  struct Document {
+    std::string path;
+    std::string text;
+    std::optional<Clock::time_point> due; // when to lint it, nullopt if it is linted
+    std::vector<LintResult> results;      // of the last lint
+  };
+
+  LintSession session;
+  std::map<std::string, Document> documents; // by URI
+  std::string input;                         // read from stdin but not handled yet
+  bool shutdown = false;
+  std::optional<int> exit_status; // set when the client says exit
+
+public:
+  explicit LspServer(const Arguments &args) : session(args) {}
+
+  int run() {
+    while (!exit_status) {
+      while (!exit_status) {
+        auto msg = take_message();
+        if (!msg)
+          break;
+        if (auto json = Json::parse(*msg))
+          handle(*json);
+      }
+      lint_due();
+      if (exit_status)
+        break;
+
+      pollfd in{STDIN_FILENO, POLLIN, 0};
+      const int n = ::poll(&in, 1, poll_timeout());
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n == 0)
+        continue;
+      char buf[1 << 16];
+      const ssize_t got = ::read(STDIN_FILENO, buf, sizeof(buf));
+      if (got < 0 && errno == EINTR)
+        continue;
+      // the client went away without saying exit
+      if (got <= 0)
+        return EXIT_FAILURE;
+      input.append(buf, got);
+    }
+    return *exit_status;
+  }
+
+private:
+  // Milliseconds until the next document is due, or -1 to wait for input forever.
+  int poll_timeout() const {
+    std::optional<Clock::time_point> next;
+    for (const auto &[uri, doc] : documents) {
+      if (doc.due && (!next || *doc.due < *next))
+        next = doc.due;
+    }
+    if (!next)
+      return -1;
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(*next - Clock::now());
+    return std::max<int>(0, static_cast<int>(left.count()) + 1);
+  }
+
+  // The content of the next complete message in `input`, nullopt if there isn't one yet.
+  std::optional<std::string> take_message() {
+    const std::size_t header_end = input.find("\r\n\r\n");
+    if (header_end == std::string::npos)
+      return std::nullopt;
+    std::optional<std::size_t> length;
+    std::istringstream headers(input.substr(0, header_end));
+    for (std::string line; std::getline(headers, line);) {
+      const std::size_t colon = line.find(':');
+      if (colon == std::string::npos)
+        continue;
+      std::string name = line.substr(0, colon);
+      for (auto &c : name) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      }
+      if (name == "content-length")
+        length = std::strtoull(line.c_str() + colon + 1, nullptr, 10);
+    }
+    const std::size_t body = header_end + 4;
+    if (!length) {
+      // there is no telling where it ends, skip the headers and hope for the best
+      input.erase(0, body);
+      return std::nullopt;
+    }
+    if (input.size() - body < *length)
+      return std::nullopt;
+    std::string msg = input.substr(body, *length);
+    input.erase(0, body + *length);
+    return msg;
+  }
+
+  void send(const Json &msg) {
+    const std::string body = msg.dump();
+    std::cout << "Content-Length: " << body.size() << "\r\n\r\n" << body << std::flush;
+  }
+
+  void respond(const Json &id, Json result) {
+    send(Json::Object{{"jsonrpc", "2.0"}, {"id", id}, {"result", std::move(result)}});
+  }
+
+  void respond_error(const Json &id, int code, const std::string &message) {
+    send(Json::Object{{"jsonrpc", "2.0"},
+                      {"id", id},
+                      {"error", Json::Object{{"code", code}, {"message", message}}}});
+  }
+
+  void notify(const char *method, Json params) {
+    send(Json::Object{{"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}});
+  }
+
+  void handle(const Json &msg) {
+    const Json *id = msg.get("id");
+    const Json *method = msg.get("method");
+    if (method == nullptr || method->string() == nullptr) {
+      // a response to something never asked, or garbage
+      if (id != nullptr && msg.get("result") == nullptr && msg.get("error") == nullptr)
+        respond_error(*id, INVALID_REQUEST, "missing method");
+      return;
+    }
+    const std::string &name = *method->string();
+    static const Json no_params = Json::Object{};
+    const Json *params_ptr = msg.get("params");
+    const Json &params = params_ptr != nullptr ? *params_ptr : no_params;
+    // a request without an id is answered with a null id
+    static const Json no_id;
+    const Json &request = id != nullptr ? *id : no_id;
+
+    if (name == "initialize") {
+      respond(request, Json::Object{
+                       {"capabilities",
+                        Json::Object{{"textDocumentSync",
+                                      Json::Object{{"openClose", true}, {"change", 1}}},
+                                     {"codeActionProvider", true}}},
+                       {"serverInfo", Json::Object{{"name", "lzn"}}},
+                   });
+    } else if (name == "shutdown") {
+      shutdown = true;
+      respond(request, nullptr);
+    } else if (name == "exit") {
+      exit_status = shutdown ? EXIT_SUCCESS : EXIT_FAILURE;
+    } else if (name == "textDocument/didOpen") {
+      did_open(params);
+    } else if (name == "textDocument/didChange") {
+      did_change(params);
+    } else if (name == "textDocument/didClose") {
+      did_close(params);
+    } else if (name == "textDocument/codeAction") {
+      respond(request, code_actions(params));
+    } else if (id != nullptr) {
+      respond_error(*id, METHOD_NOT_FOUND, "unsupported method: " + name);
+    }
+    // other notifications, like initialized and didSave, need nothing
+  }
+
+  void did_open(const Json &params) {
+    auto uri = params.path({"textDocument", "uri"});
+    auto text = params.path({"textDocument", "text"});
+    if (uri == nullptr || uri->string() == nullptr || text == nullptr || text->string() == nullptr)
+      return;
+    Document &doc = documents[*uri->string()];
+    doc.path = uri_to_path(*uri->string());
+    doc.text = *text->string();
+    doc.due = Clock::now();
+  }
+
+  void did_change(const Json &params) {
+    auto uri = params.path({"textDocument", "uri"});
+    auto changes = params.get("contentChanges");
+    if (uri == nullptr || uri->string() == nullptr || changes == nullptr ||
+        changes->array() == nullptr || changes->array()->empty())
+      return;
+    auto it = documents.find(*uri->string());
+    if (it == documents.end())
+      return;
+    // the sync is full, so the last change is the whole document
+    auto text = changes->array()->back().get("text");
+    if (text == nullptr || text->string() == nullptr)
+      return;
+    it->second.text = *text->string();
+    it->second.due = Clock::now() + RELINT_DELAY;
+  }
+
+  void did_close(const Json &params) {
+    auto uri = params.path({"textDocument", "uri"});
+    if (uri == nullptr || uri->string() == nullptr)
+      return;
+    documents.erase(*uri->string());
+    notify("textDocument/publishDiagnostics",
+           Json::Object{{"uri", *uri->string()}, {"diagnostics", Json::Array{}}});
+  }
+
+  void lint_due() {
+    const auto now = Clock::now();
+    for (auto &[uri, doc] : documents) {
+      if (doc.due && *doc.due <= now)
+        lint(uri, doc);
+    }
+  }
+
+  void lint(const std::string &uri, Document &doc) {
+    doc.due.reset();
+    std::ostringstream errs;
+    ModelLint lint;
+    // a document in the middle of an edit can make the linter throw, which is reported like a
+    // parse error instead of ending the server
+    try {
+      lint = lint_model(session, LintTarget{doc.path, {}, doc.text}, errs);
+    } catch (const std::exception &e) {
+      errs << "the linter failed: " << e.what() << std::endl;
+    } catch (...) {
+      errs << "the linter failed" << std::endl;
+    }
+    doc.results = std::move(lint.results);
+
+    Json::Array diagnostics;
+    if (!lint.ok) {
+      diagnostics.push_back(Json::Object{{"range", lsp_range(FileContents())},
+                                         {"severity", SEVERITY_ERROR},
+                                         {"source", "lzn"},
+                                         {"message", errs.str()}});
+    }
+    for (const auto &res : doc.results) {
+      if (res.content.filename == doc.path || res.content.is_empty())
+        diagnostics.push_back(diagnostic(res));
+    }
+    notify("textDocument/publishDiagnostics",
+           Json::Object{{"uri", uri}, {"diagnostics", std::move(diagnostics)}});
+  }
+
+  static Json diagnostic(const LintResult &res) {
+    Json::Array related;
+    for (const auto &sub : res.sub_results) {
+      if (sub.content.filename.empty())
+        continue;
+      related.push_back(Json::Object{
+          {"location", Json::Object{{"uri", path_to_uri(sub.content.filename)},
+                                    {"range", lsp_range(sub.content)}}},
+          {"message", sub.message}});
+    }
+    return Json::Object{{"range", lsp_range(res.content)},
+                        {"severity", SEVERITY_WARNING},
+                        {"code", res.rule->name},
+                        {"source", "lzn"},
+                        {"message", res.message},
+                        {"relatedInformation", std::move(related)}};
+  }
+
+  // A quick fix for every result with a rewrite where the client asks for actions.
+  Json code_actions(const Json &params) const {
+    Json::Array actions;
+    auto uri = params.path({"textDocument", "uri"});
+    auto asked = params.get("range");
+    if (uri == nullptr || uri->string() == nullptr || asked == nullptr)
+      return actions;
+    auto it = documents.find(*uri->string());
+    if (it == documents.end())
+      return actions;
+
+    for (const auto &res : it->second.results) {
+      if (!res.rewrite || res.content.filename != it->second.path)
+        continue;
+      const Json where = lsp_range(res.content);
+      if (!ranges_meet(where, *asked))
+        continue;
+      Json::Array edits{Json::Object{{"range", where}, {"newText", *res.rewrite}}};
+      actions.push_back(Json::Object{
+          {"title", "rewrite as: " + *res.rewrite},
+          {"kind", "quickfix"},
+          {"diagnostics", Json::Array{diagnostic(res)}},
+          {"edit",
+           Json::Object{{"changes", Json::Object{{*uri->string(), std::move(edits)}}}}},
+      });
+    }
+    return actions;
+  }
+};
+} // namespace
+
+namespace LZN {
+
+int run_lsp(const Arguments &args) {
+  return LspServer(args).run();
+}
+
+} // namespace LZN
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "argparse.hpp"
+
+namespace LZN {
+
+// Speak the Language Server Protocol on stdin and stdout until the client says exit. Open documents
+// are kept in memory and linted from there, a while after the last change so that linting doesn't
+// happen on every keystroke. The results are published as diagnostics, with the sub results as
+// related information, and rewrites are offered as code actions. Returns the exit status.
+int run_lsp(const Arguments &args);
+
+} // namespace LZN
@@ -1,10 +1,10 @@
 #include "argparse.hpp"
+#include "daemon.hpp"
+#include "lint.hpp"
+#include "lsp.hpp"
 #include <iostream>
-#include <linter/registry.hpp>
 #include <linter/stdoutprinter.hpp>
-#include <minizinc/file_utils.hh>
-#include <minizinc/parser.hh>
-#include <minizinc/typecheck.hh>
+#include <optional>
 
 int main(int argc, char *argv[]) {
   const LZN::ArgRes res = LZN::parse_args(argc, argv);
@@ -20,50 +20,45 @@ int main(int argc, char *argv[]) {
   }
 
   const LZN::Arguments args = std::get<LZN::Arguments>(res);
-  std::vector<std::string> filenames = {args.model_filename};
+  if (!args.daemon_socket.empty())
+    return LZN::run_daemon(args.daemon_socket);
+  if (args.lsp)
+    return LZN::run_lsp(args);
 
-  // parse and typecheck
-  MiniZinc::GCLock lock;
-  std::vector<std::string> includePaths = {
-      MiniZinc::FileUtils::file_path(MiniZinc::FileUtils::share_directory()) + "/std/"};
-  std::stringstream errstream;
-  MiniZinc::Env env;
-  MiniZinc::Model *m = MiniZinc::parse(env, filenames, args.datafiles, "", "", includePaths, false,
-                                       false, false, false, errstream);
-
-  char empty_check;
-  if (errstream.readsome(&empty_check, 1) == 1) {
-    std::cerr << "parse errors:" << std::endl;
-    std::cerr << empty_check;
-    errstream >> std::cerr.rdbuf();
-  }
-  if (m == nullptr)
-    return EXIT_FAILURE;
-
-  std::vector<MiniZinc::TypeError> typeErrors;
-  try {
-    MiniZinc::typecheck(env, m, typeErrors, true, false);
-  } catch (MiniZinc::TypeError &te) {
-    typeErrors.push_back(te);
-    ;
-  }
-  if (!typeErrors.empty()) {
-    std::cerr << "type errors:" << std::endl;
-    for (auto &te : typeErrors) {
-      std::cerr << te.loc() << ":" << std::endl;
-      std::cerr << te.what() << ": " << te.msg() << std::endl;
-    }
+  const auto targets_res = LZN::lint_targets(args);
+  if (auto err = std::get_if<LZN::ArgError>(&targets_res); err != nullptr) {
+    std::cerr << err->msg << std::endl;
     return EXIT_FAILURE;
   }
+  const auto &targets = std::get<std::vector<LZN::LintTarget>>(targets_res);
+  if (!args.client_socket.empty())
+    return LZN::run_client(args.client_socket, args, targets);
 
-  // run linter
-  LZN::LintEnv lenv(m, env, includePaths);
-  for (auto rule : LZN::Registry::iter()) {
-    if (!LZN::is_rule_ignored(args, *rule))
-      rule->run(lenv);
+  // the standard library and the rules are looked up once for all models, which are then linted
+  // one after the other since the parser isn't thread safe
+  const LZN::LintSession session(args);
+  std::optional<LZN::ResultCache> cache;
+  if (!args.cache_dir.empty())
+    cache.emplace(args.cache_dir, session.include_paths, session.rules);
+
+  const bool several = targets.size() > 1;
+  bool all_ok = true;
+  LZN::LintEnv::SearchStats stats;
+  for (const auto &target : targets) {
+    if (several)
+      LZN::stdout_print_heading(target.model);
+    const LZN::ModelLint lint =
+        LZN::lint_cached(session, target, std::cerr, cache ? &*cache : nullptr);
+    all_ok = all_ok && lint.ok;
+    LZN::stdout_print(lint.results);
+    stats.hits += lint.search_stats.hits;
+    stats.misses += lint.search_stats.misses;
   }
 
-  LZN::stdout_print(lenv.results());
+  if (args.print_search_stats) {
+    std::cerr << "model searches: " << stats.hits << " cached, " << stats.misses << " performed"
+              << std::endl;
+  }
 
-  return EXIT_SUCCESS;
+  return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -1,5 +1,9 @@
 #include "test_common.hpp"
 
+#include <algorithm>
+#include <linter/incremental.hpp>
+#include <tuple>
+
 template <typename T>
 std::optional<const MiniZinc::VarDecl *> find_first_array(const T &vec) {
   for (auto vd : vec) {
@@ -9,6 +13,16 @@ std::optional<const MiniZinc::VarDecl *> find_first_array(const T &vec) {
   return std::nullopt;
 }
 
+// The user defined declaration named `name`, fails the test if there isn't one.
+const MiniZinc::VarDecl *find_decl(LZN::LintEnv &lenv, const char *name) {
+  for (auto vd : lenv.user_defined_variable_declarations()) {
+    if (vd->id()->str() == name)
+      return vd;
+  }
+  FAIL("no declaration named " << name);
+  return nullptr;
+}
+
 #define RUN_EVERY_INDEX(expect)                                                                    \
   auto vardecls = lenv.user_defined_variable_declarations();                                       \
   auto arr = find_first_array(vardecls);                                                           \
@@ -82,5 +96,503 @@ TEST_CASE("every_index_touched", "[lintenv]") {
     RUN_EVERY_INDEX(false);
   }
 
+  SECTION("two dimensions transposed") {
+    LZN_ONLY_PARSE("array[1..2, 1..3] of var int: arr;\n"
+                   "constraint forall(j in 1..3, i in 1..2)(arr[i,j] = 1)");
+    RUN_EVERY_INDEX(true);
+  }
+
+  SECTION("coverage") {
+    LZN_ONLY_PARSE("array[1..3] of var int: arr;\n"
+                   "constraint forall(i in 1..3)(arr[i] = 1);\n"
+                   "constraint arr[2] = 2;");
+    auto arr = find_first_array(lenv.user_defined_variable_declarations());
+    REQUIRE(arr);
+    auto coverage = lenv.array_coverage(arr.value());
+    REQUIRE(coverage != nullptr);
+    CHECK(coverage->accesses.size() == 2);
+    CHECK(coverage->covering.size() == 1);
+    CHECK(coverage->covered());
+    CHECK(lenv.array_coverage(nullptr) == nullptr);
+  }
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("search_model caches hits", "[lintenv]") {
+  LZN_MODEL_INIT;
+  LZN_ONLY_PARSE("var int: x;\n"
+                 "constraint x = 1 \\/ x = 2;");
+
+  using ExpressionId = MiniZinc::Expression::ExpressionId;
+  const auto id = lenv.userdef_only_builder().in_everywhere().under(ExpressionId::E_ID).build();
+  const auto eq = lenv.userdef_only_builder()
+                      .in_constraint()
+                      .under(MiniZinc::BinOpType::BOT_OR)
+                      .under(MiniZinc::BinOpType::BOT_EQ)
+                      .capture()
+                      .build();
+  CHECK(id.hash() ==
+        lenv.userdef_only_builder().in_everywhere().under(ExpressionId::E_ID).build().hash());
+
+  lenv.request_search(eq);
+  lenv.request_search(eq);
+  lenv.perform_requested_searches();
+  CHECK(lenv.search_stats().hits == 1);
+  CHECK(lenv.search_stats().misses == 1);
+
+  auto first = lenv.search_model(eq);
+  auto second = lenv.search_model(eq);
+  CHECK(lenv.search_stats().hits == 3);
+  CHECK(lenv.search_stats().misses == 1);
+  std::size_t count = 0;
+  while (first.next()) {
+    REQUIRE(second.next());
+    CHECK(first.capture(0) == second.capture(0));
+    ++count;
+  }
+  CHECK(!second.next());
+  CHECK(count == 2);
+
+  lenv.search_model(id);
+  CHECK(lenv.search_stats().misses == 2);
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("prepass same as lazy caches", "[lintenv]") {
+  LZN_MODEL_INIT;
+  const char *model_str =
+      "var int: x;\n"
+      "var 1..3: y = let {var int: z; constraint z > 0} in z;\n"
+      "array[1..3] of var int: arr;\n"
+      "constraint forall(i in 1..3)(arr[i] = i);\n"
+      "constraint x = sum([arr[i] | i in 1..3]);\n"
+      "function var int: f(var int: a) = let {var int: b = a; constraint b > 1} in b;\n"
+      "solve :: int_search([x], input_order, indomain_min) minimize x + y;\n";
+  LZN_ONLY_PARSE(model_str);
+  LZN::LintEnv prepassed(model, env, includePaths);
+  prepassed.prepass();
+
+  CHECK(lenv.user_defined_functions() == prepassed.user_defined_functions());
+  CHECK(lenv.solve_item() == prepassed.solve_item());
+  CHECK(lenv.user_defined_variable_declarations() ==
+        prepassed.user_defined_variable_declarations());
+  CHECK(lenv.constraints() == prepassed.constraints());
+  CHECK(lenv.comprehensions() == prepassed.comprehensions());
+  CHECK(lenv.search_hinted_variables() == prepassed.search_hinted_variables());
+  CHECK(!prepassed.constraints().empty());
+  CHECK(lenv.generators().size() == 2);
+  REQUIRE(lenv.generators().size() == prepassed.generators().size());
+  for (const auto &[vd, gen] : lenv.generators()) {
+    auto other = prepassed.generator_of(vd);
+    REQUIRE(other != nullptr);
+    CHECK(other->comp == gen.comp);
+    CHECK(other->gen == gen.gen);
+  }
+  CHECK(prepassed.search_stats().misses == 0);
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("run_rules concurrently same as sequentially", "[lintenv]") {
+  LZN_MODEL_INIT;
+  LZN_ONLY_PARSE("var 0..1: x;\n"
+                 "var int: y;\n"
+                 "array[1..3] of var 0..1: arr;\n"
+                 "constraint y = if x > 0 then 2 else 0 endif;\n"
+                 "constraint element(x, arr, 1);\n"
+                 "constraint sum([bool2int(arr[i] = 1) | i in 1..3]) = 1;\n"
+                 "constraint increasing(arr);\n"
+                 "solve satisfy;\n");
+  LZN::LintEnv concurrent(model, env, includePaths, 4);
+
+  std::vector<const LZN::LintRule *> rules;
+  for (auto rule : LZN::Registry::iter()) {
+    rules.push_back(rule);
+  }
+  for (auto *e : {&lenv, &concurrent}) {
+    for (auto rule : rules) {
+      rule->prepare(*e);
+    }
+    e->perform_requested_searches();
+    e->run_rules(rules);
+  }
+
+  const auto &expected = lenv.results();
+  const auto &results = concurrent.results();
+  CHECK(!expected.empty());
+  REQUIRE(results.size() == expected.size());
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    CHECK(results[i] == expected[i]);
+    CHECK(results[i].message == expected[i].message);
+  }
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("def use index", "[lintenv]") {
+  LZN_MODEL_INIT;
+  LZN_ONLY_PARSE("int: n = 3;\n"
+                 "array[1..n] of var int: arr;\n"
+                 "var int: unused = n;\n"
+                 "function var int: f(var int: a) = let {var int: b = a} in b + n;\n"
+                 "constraint f(arr[1]) > 0;\n");
+
+  const auto &index = lenv.def_use();
+  auto number = [&index](const char *name) {
+    for (std::size_t d = 0; d < index.size(); ++d) {
+      const auto &decl = index.decl(d);
+      if (auto fi = std::get_if<const MiniZinc::FunctionI *>(&decl)) {
+        if ((*fi)->id() == name)
+          return d;
+      } else if (std::get<const MiniZinc::VarDecl *>(decl)->id()->str() == name) {
+        return d;
+      }
+    }
+    FAIL("no declaration named " << name);
+    return LZN::DefUseIndex::NONE;
+  };
+  auto used = [&index](auto row) {
+    std::vector<std::size_t> decls;
+    for (const auto &u : row) {
+      decls.push_back(u.decl);
+    }
+    std::sort(decls.begin(), decls.end());
+    return decls;
+  };
+  auto sorted = [](std::vector<std::size_t> v) {
+    std::sort(v.begin(), v.end());
+    return v;
+  };
+
+  const std::size_t n = number("n"), arr = number("arr"), unused = number("unused"),
+                    f = number("f"), a = number("a"), b = number("b");
+  CHECK(index.number_of(index.decl(f)) == f);
+
+  CHECK(used(index.uses(n)).empty());
+  CHECK(used(index.uses(arr)) == std::vector<std::size_t>{n});
+  CHECK(used(index.uses(f)) == sorted({b, n}));
+  CHECK(used(index.uses(b)) == std::vector<std::size_t>{a});
+  CHECK(used(index.users(n)) == sorted({arr, unused, f}));
+  CHECK(used(index.users(a)) == std::vector<std::size_t>{b});
+  REQUIRE(index.contained(f).size() == 1);
+  CHECK(*index.contained(f).begin() == b);
+  CHECK(used(index.root_uses()) == sorted({arr, f}));
+
+  const auto reached = index.reachable_from_roots();
+  for (auto d : {n, arr, f, a, b}) {
+    CHECK(reached[d]);
+  }
+  CHECK(!reached[unused]);
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("item fingerprints", "[lintenv]") {
+  LZN_MODEL_INIT;
+  auto fingerprints = [&](const std::string &s) {
+    MiniZinc::Env env; // every model gets its own
+    LZN_ONLY_PARSE(s);
+    std::vector<std::uint64_t> fps;
+    for (const auto &entry : LZN::ItemFingerprints(lenv.flat_tree())) {
+      fps.push_back(entry.fingerprint);
+    }
+    return fps;
+  };
+
+  const std::string decls = "int: n = 3;\n"
+                            "array[1..n] of var int: x;\n";
+  const std::string cons = "constraint x[1] < x[2];\n"
+                           "constraint x[2] != 1;\n";
+  const auto base = fingerprints(decls + cons);
+  REQUIRE(base.size() == 4);
+
+  SECTION("moved down") { CHECK(fingerprints("\n\n" + decls + cons) == base); }
+
+  SECTION("one item changed") {
+    const auto fps = fingerprints(decls + "constraint x[1] < x[2];\n"
+                                          "constraint x[2] != 2;\n");
+    REQUIRE(fps.size() == 4);
+    CHECK(std::equal(fps.begin(), fps.begin() + 3, base.begin()));
+    CHECK(fps[3] != base[3]);
+  }
+
+  SECTION("referred declaration changed") {
+    const auto fps = fingerprints("int: n = 4;\n"
+                                  "array[1..n] of var int: x;\n" +
+                                  cons);
+    REQUIRE(fps.size() == 4);
+    for (std::size_t i = 0; i < fps.size(); ++i) {
+      CHECK(fps[i] != base[i]);
+    }
+  }
+
+  SECTION("results relative to their item") {
+    LZN_ONLY_PARSE(decls + cons);
+    const LZN::ItemFingerprints items(lenv.flat_tree());
+    const LZN::LintRule *rule = *LZN::Registry::iter().begin();
+    LZN::LintResult r(LZN::FileContents::OneLineMarked(3, 12, 15), MODEL_FILENAME, rule, "");
+    r.emplace_subresult("note");
+    REQUIRE(items.item_of(r) == 2);
+
+    const LZN::LintResult rel = items.relative(r, 2);
+    CHECK(rel.content.filename.empty());
+    const LZN::FileContents::Region first_line = LZN::FileContents::OneLineMarked(0, 12, 15);
+    CHECK(rel.content.region == first_line);
+    CHECK(items.absolute(rel, 2) == r);
+
+    r.emplace_subresult("elsewhere", LZN::FileContents::OneLineMarked(1, 1), MODEL_FILENAME);
+    CHECK(items.item_of(r) == LZN::ItemFingerprints::NONE);
+  }
+
+  LZN_TEST_CASE_END;
+}
+
+namespace {
+// Points out every identifier in a constraint, and its declaration in a sub result, which is in
+// another item for everything but generator variables.
+class UsesRule : public LZN::LintRule {
+public:
+  constexpr UsesRule()
+      : LintRule(1000, "uses", LZN::Category::STYLE, /*thread_safe=*/true, LZN::RuleScope::ITEM) {}
+
+private:
+  virtual void do_run(LZN::LintEnv &env) const override {
+    const auto s = env.userdef_only_builder()
+                       .in_constraint()
+                       .under(MiniZinc::Expression::E_ID)
+                       .capture()
+                       .build();
+    auto ms = env.search_model(s);
+    while (ms.next()) {
+      auto id = ms.capture_cast<MiniZinc::Id>(0);
+      auto &lr = env.emplace_result(LZN::FileContents::Type::OneLineMarked, id->loc(), this,
+                                    std::string("uses ") + id->str().c_str());
+      lr.add_relevant_decl(id);
+    }
+  }
+};
+
+// Sort `results` by everything that is printed.
+void sort_results(std::vector<LZN::LintResult> &results) {
+  std::sort(results.begin(), results.end(), [](const auto &a, const auto &b) {
+    return std::tie(a.rule, a.content, a.message) < std::tie(b.rule, b.content, b.message);
+  });
+}
+} // namespace
+
+TEST_CASE("incremental linting", "[lintenv]") {
+  LZN_MODEL_INIT;
+  const UsesRule uses;
+  std::vector<const LZN::LintRule *> rules;
+  REQUIRE_NOTHROW(rules = {LZN::Registry::get(7), LZN::Registry::get(26),
+                           LZN::Registry::get(19)}); // var-in-gen, var-in-if-where, one-based
+
+  // lint `s` with `rules`, incrementally if `items` isn't nullptr
+  auto lint = [&](const std::string &s, LZN::ItemResults *items) {
+    MiniZinc::Env env; // every model gets its own
+    LZN_ONLY_PARSE(s);
+    lenv.prepass();
+    LZN::LintEnv::SearchStats stats;
+    auto results = items != nullptr ? LZN::run_incrementally(lenv, rules, *items, stats)
+                                    : lenv.lint(rules);
+    sort_results(results);
+    return results;
+  };
+  auto check_same = [](const std::vector<LZN::LintResult> &a,
+                       const std::vector<LZN::LintResult> &b) {
+    REQUIRE(a.size() == b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      CHECK(a[i] == b[i]);
+      CHECK(a[i].message == b[i].message);
+      REQUIRE(a[i].sub_results.size() == b[i].sub_results.size());
+      for (std::size_t j = 0; j < a[i].sub_results.size(); ++j) {
+        CHECK(a[i].sub_results[j].content == b[i].sub_results[j].content);
+      }
+    }
+  };
+
+  const std::string before = "int: n = 3;\n"
+                             "array[0..n] of var 1..3: x;\n"
+                             "var 1..3: y;\n"
+                             "constraint forall(i in 1..n where x[i] > 1)(x[i] != y);\n"
+                             "constraint if y > 1 then x[1] = 1 else x[2] = 1 endif;\n"
+                             "constraint x[3] = 2;\n";
+  // moved down a line, and the last constraint changed
+  const std::string after = "\n"
+                            "int: n = 3;\n"
+                            "array[0..n] of var 1..3: x;\n"
+                            "var 1..3: y;\n"
+                            "constraint forall(i in 1..n where x[i] > 1)(x[i] != y);\n"
+                            "constraint if y > 1 then x[1] = 1 else x[2] = 1 endif;\n"
+                            "constraint if y > 2 then x[3] = 3 else true endif;\n";
+
+  LZN::ItemResults items;
+  const auto first = lint(before, &items);
+  check_same(first, lint(before, nullptr));
+  REQUIRE(!items.empty());
+
+  SECTION("same as a full run") { check_same(lint(after, &items), lint(after, nullptr)); }
+
+  SECTION("unchanged items are replayed") {
+    for (auto &[key, results] : items) {
+      for (auto &r : results) {
+        r.message = "stored";
+      }
+    }
+    const auto results = lint(after, &items);
+    std::size_t stored = 0, fresh = 0;
+    for (const auto &r : results) {
+      const auto *olm = std::get_if<LZN::FileContents::OneLineMarked>(&r.content.region);
+      if (r.rule->scope != LZN::RuleScope::ITEM || olm == nullptr)
+        continue;
+      if (olm->line == 7) {
+        CHECK(r.message != "stored");
+        ++fresh;
+      } else {
+        CHECK(r.message == "stored");
+        ++stored;
+      }
+    }
+    CHECK(stored > 0);
+    CHECK(fresh > 0);
+  }
+
+  SECTION("sub result in another item") {
+    rules.push_back(&uses);
+    LZN::ItemResults with_uses;
+    check_same(lint(before, &with_uses), lint(before, nullptr));
+    for (const auto &[key, results] : with_uses) {
+      CHECK(key.first != uses.id);
+    }
+    CHECK(!with_uses.empty());
+    check_same(lint(after, &with_uses), lint(after, nullptr));
+  }
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("dense ids", "[lintenv]") {
+  LZN_MODEL_INIT;
+  LZN_ONLY_PARSE("var int: x;\n"
+                 "var int: y;\n"
+                 "function var int: f(var int: a) = a;\n"
+                 "constraint x = sum([i | i in 1..3]) /\\ forall([y > j | j in 1..2]);\n"
+                 "solve :: int_search([y], input_order, indomain_min) satisfy;\n");
+
+  const auto &vardecls = lenv.user_defined_variable_declarations();
+  const auto &ids = lenv.vardecl_ids();
+  REQUIRE(ids.size() == vardecls.size());
+  for (std::size_t i = 0; i < vardecls.size(); ++i) {
+    CHECK(ids[i] == vardecls[i]);
+    CHECK(ids.id_of(vardecls[i]) == i);
+    CHECK(lenv.search_hinted_ids().contains(i) == lenv.is_search_hinted(vardecls[i]));
+  }
+  CHECK(ids.id_of(nullptr) == LZN::DenseIds<MiniZinc::VarDecl>::NONE);
+
+  CHECK(lenv.function_ids().size() == lenv.user_defined_functions().size());
+  const auto &comps = lenv.comprehension_ids();
+  CHECK(comps.size() == 2);
+  for (auto comp : comps) {
+    CHECK(lenv.comprehensions().count(comp) == 1);
+  }
+
+  LZN::IdSet set(130);
+  CHECK(set.empty());
+  for (std::size_t id : {0, 63, 64, 129}) {
+    set.insert(id);
+  }
+  set.erase(63);
+  std::vector<std::size_t> elems;
+  set.for_each([&elems](std::size_t id) { elems.push_back(id); });
+  CHECK(elems == std::vector<std::size_t>{0, 64, 129});
+  CHECK(set.contains(64));
+  CHECK(!set.contains(63));
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("generator_of", "[lintenv]") {
+  LZN_MODEL_INIT;
+  LZN_ONLY_PARSE("var int: x;\n"
+                 "constraint x = sum([i * j | i in 1..3, j, k in i..3]);\n");
+
+  REQUIRE(lenv.comprehensions().size() == 1);
+  auto comp = *lenv.comprehensions().begin();
+  REQUIRE(comp->numberOfGenerators() == 2);
+  for (unsigned int gen = 0; gen < comp->numberOfGenerators(); ++gen) {
+    for (unsigned int decl = 0; decl < comp->numberOfDecls(gen); ++decl) {
+      auto g = lenv.generator_of(comp->decl(gen, decl));
+      REQUIRE(g != nullptr);
+      CHECK(g->comp == comp);
+      CHECK(g->gen == gen);
+    }
+  }
+  CHECK(lenv.generators().size() == 3);
+  CHECK(lenv.generator_of(lenv.user_defined_variable_declarations().front()) == nullptr);
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("depends_on_instance", "[lintenv]") {
+  LZN_MODEL_INIT;
+  LZN_ONLY_PARSE("int: n = 3;\n"
+                 "var 0..n: x;\n"
+                 "var 1..3: y;\n"
+                 "var int: z = x + 1;\n"
+                 "constraint let {int: m = n + 1} in y < m;\n"
+                 "constraint sum([y * i | i in 1..n]) > 0;\n"
+                 "constraint y > 1;\n");
+
+  CHECK(lenv.depends_on_instance(find_decl(lenv, "x")->ti()->domain()));
+  CHECK(!lenv.depends_on_instance(find_decl(lenv, "y")->ti()->domain()));
+  CHECK(lenv.depends_on_instance(find_decl(lenv, "z")->e()));
+  CHECK(lenv.depends_on_instance(find_decl(lenv, "z")->e()));
+  CHECK(!lenv.depends_on_instance(nullptr));
+
+  const auto &constraints = lenv.constraints();
+  REQUIRE(constraints.size() == 3);
+  CHECK(lenv.depends_on_instance(constraints[0])); // let-bound parameter
+  CHECK(lenv.depends_on_instance(constraints[1])); // generator
+  CHECK(!lenv.depends_on_instance(constraints[2]));
+
+  LZN_TEST_CASE_END;
+}
+
+TEST_CASE("int_bounds", "[lintenv]") {
+  LZN_MODEL_INIT;
+  LZN_ONLY_PARSE("int: n = 4;\n"
+                 "int: m;\n"
+                 "set of int: ns = 2..n;\n"
+                 "array[ns] of var -1..3: xs;\n"
+                 "var 0..1: b;\n"
+                 "var int: free;\n"
+                 "constraint forall(i in ns)(xs[i] + 2 * b >= -(n div 2));\n"
+                 "constraint abs(xs[n]) < max(m, free);\n");
+
+  using LZN::IntInterval;
+  CHECK(lenv.int_bounds(find_decl(lenv, "n")->e()) == IntInterval::of(4, 4));
+  CHECK(lenv.int_bounds(find_decl(lenv, "ns")->e()) == IntInterval::of(2, 4));
+  CHECK(lenv.int_bounds(find_decl(lenv, "xs")->ti()->domain()) == IntInterval::of(-1, 3));
+  CHECK(lenv.int_bounds(nullptr) == IntInterval::unknown());
+
+  const auto &constraints = lenv.constraints();
+  REQUIRE(constraints.size() == 2);
+  // forall(...) is a call on a comprehension of `lhs >= rhs`
+  auto forall = constraints[0]->cast<MiniZinc::Call>();
+  auto comp = forall->arg(0)->cast<MiniZinc::Comprehension>();
+  auto geq = comp->e()->cast<MiniZinc::BinOp>();
+  auto plus = geq->lhs()->cast<MiniZinc::BinOp>();
+  CHECK(lenv.int_bounds(plus->lhs()) == IntInterval::of(-1, 3)); // xs[i]
+  CHECK(lenv.int_bounds(plus) == IntInterval::of(-1, 5));
+  CHECK(lenv.int_bounds(geq->rhs()) == IntInterval::of(-2, -2));
+  CHECK(lenv.int_bounds(comp->decl(0, 0)) == IntInterval::of(2, 4)); // i
+  CHECK(!lenv.int_bounds(geq).known());                              // bool
+
+  auto lt = constraints[1]->cast<MiniZinc::BinOp>();
+  CHECK(lenv.int_bounds(lt->lhs()) == IntInterval::of(0, 3));
+  CHECK(!lenv.int_bounds(lt->rhs()).known());
+
   LZN_TEST_CASE_END;
 }
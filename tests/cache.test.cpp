@@ -0,0 +1,190 @@
+#include "test_common.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <linter/cache.hpp>
+#include <unistd.h>
+
+namespace {
+namespace fs = std::filesystem;
+using LZN::FileContents;
+using LZN::LintResult;
+
+// A directory of its own in the temporary directory, removed with everything in it.
+class TempDir {
+  fs::path path;
+
+public:
+  TempDir() {
+    static unsigned int counter = 0;
+    path = fs::temp_directory_path() / ("lzn-cache-test-" + std::to_string(::getpid()) + '-' +
+                                        std::to_string(counter++));
+    fs::create_directories(path);
+  }
+  ~TempDir() {
+    std::error_code ec;
+    fs::remove_all(path, ec);
+  }
+  TempDir(const TempDir &) = delete;
+  TempDir &operator=(const TempDir &) = delete;
+
+  std::string file(const std::string &name) const { return (path / name).string(); }
+};
+
+void write_file(const std::string &path, const std::string &contents) {
+  std::ofstream f(path, std::ios::binary | std::ios::trunc);
+  f << contents;
+}
+
+void check_same(const std::vector<LintResult> &a, const std::vector<LintResult> &b) {
+  REQUIRE(a.size() == b.size());
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    CHECK(a[i] == b[i]);
+    CHECK(a[i].message == b[i].message);
+  }
+}
+} // namespace
+
+TEST_CASE("result cache", "[cache]") {
+  const TempDir tmp;
+  const std::string dir = tmp.file("cache");
+  const std::vector<std::string> include_paths = {tmp.file("std")};
+  const LZN::LintRule *rule;
+  const LZN::LintRule *other_rule;
+  REQUIRE_NOTHROW(rule = LZN::Registry::get(19));
+  REQUIRE_NOTHROW(other_rule = LZN::Registry::get(7));
+  const std::vector<const LZN::LintRule *> rules = {rule};
+
+  const std::string model = tmp.file("model.mzn");
+  const std::string data = tmp.file("data.dzn");
+  const std::string included = tmp.file("included.mzn");
+  write_file(model, "include \"included.mzn\";\n"
+                    "int: n;\n"
+                    "array[0..n] of var int: xs;\n");
+  write_file(data, "n = 3;\n");
+  write_file(included, "var 1..3: y;\n");
+  LZN::LintTarget target{model, {data}, std::nullopt};
+
+  std::vector<LintResult> results;
+  results.emplace_back(FileContents::OneLineMarked(3, 7, 10), model.c_str(), rule, "first");
+  results.emplace_back(FileContents::MultiLine(1, 1), included.c_str(), rule, "second");
+
+  const LZN::ResultCache cache(dir, include_paths, rules);
+  CHECK(!cache.lookup(target));
+  cache.store(target, results, {included});
+
+  SECTION("stored and looked up") {
+    const auto found = cache.lookup(target);
+    REQUIRE(found);
+    check_same(*found, results);
+  }
+
+  SECTION("shared between caches of the same session") {
+    const auto found = LZN::ResultCache(dir, include_paths, rules).lookup(target);
+    REQUIRE(found);
+    check_same(*found, results);
+  }
+
+  SECTION("model changed") {
+    write_file(model, "int: n;\n"
+                      "array[1..n] of var int: xs;\n");
+    CHECK(!cache.lookup(target));
+  }
+
+  SECTION("contents given instead of the file") {
+    target.contents = "int: n;\n";
+    CHECK(!cache.lookup(target));
+  }
+
+  SECTION("included file changed") {
+    write_file(included, "var 1..4: y;\n");
+    CHECK(!cache.lookup(target));
+  }
+
+  SECTION("included file removed") {
+    fs::remove(included);
+    CHECK(!cache.lookup(target));
+  }
+
+  SECTION("data file changed") {
+    write_file(data, "n = 4;\n");
+    CHECK(!cache.lookup(target));
+  }
+
+  SECTION("other data files") {
+    target.datafiles.clear();
+    CHECK(!cache.lookup(target));
+  }
+
+  SECTION("other rules") {
+    CHECK(!LZN::ResultCache(dir, include_paths, {rule, other_rule}).lookup(target));
+    CHECK(!LZN::ResultCache(dir, include_paths, {other_rule}).lookup(target));
+  }
+
+  SECTION("other include paths") {
+    CHECK(!LZN::ResultCache(dir, {tmp.file("other")}, rules).lookup(target));
+  }
+}
+
+TEST_CASE("item results cache", "[cache]") {
+  const TempDir tmp;
+  const std::string dir = tmp.file("cache");
+  const std::vector<std::string> include_paths = {tmp.file("std")};
+  const LZN::LintRule *rule;
+  const LZN::LintRule *other_rule;
+  REQUIRE_NOTHROW(rule = LZN::Registry::get(7));
+  REQUIRE_NOTHROW(other_rule = LZN::Registry::get(26));
+  const std::vector<const LZN::LintRule *> rules = {rule, other_rule};
+
+  const std::string model = tmp.file("model.mzn");
+  const std::string data = tmp.file("data.dzn");
+  write_file(model, "var 1..3: y;\n");
+  write_file(data, "n = 3;\n");
+  const LZN::LintTarget target{model, {data}, std::nullopt};
+
+  LZN::ItemResults items;
+  items[{rule->id, 42}].emplace_back(FileContents::OneLineMarked(0, 3, 5), "", rule, "first");
+  auto &with_sub = items[{other_rule->id, 7}].emplace_back(FileContents::MultiLine(0, 2), "",
+                                                           other_rule, "second");
+  with_sub.emplace_subresult("here", FileContents::OneLineMarked(1, 1, 4), "");
+  items[{other_rule->id, 42}];
+
+  const LZN::ResultCache cache(dir, include_paths, rules);
+  CHECK(cache.lookup_items(target).empty());
+  cache.store_items(target, items);
+
+  auto check_found = [&](const LZN::ItemResults &found) {
+    REQUIRE(found.size() == items.size());
+    for (const auto &[key, results] : items) {
+      const auto it = found.find(key);
+      REQUIRE(it != found.end());
+      check_same(it->second, results);
+    }
+    const auto &sub = found.at({other_rule->id, 7}).front().sub_results;
+    REQUIRE(sub.size() == 1);
+    CHECK(sub.front().message == "here");
+    CHECK(sub.front().content.region == FileContents::Region(FileContents::OneLineMarked(1, 1, 4)));
+  };
+
+  SECTION("stored and looked up") { check_found(cache.lookup_items(target)); }
+
+  SECTION("kept when the model changes") {
+    write_file(model, "var 1..4: y;\n");
+    check_found(cache.lookup_items(target));
+  }
+
+  SECTION("data file changed") {
+    write_file(data, "n = 4;\n");
+    CHECK(cache.lookup_items(target).empty());
+  }
+
+  SECTION("other rules") {
+    CHECK(LZN::ResultCache(dir, include_paths, {rule}).lookup_items(target).empty());
+  }
+
+  SECTION("not mixed up with the whole model entry") {
+    CHECK(!cache.lookup(target));
+    cache.store(target, {}, {});
+    check_found(cache.lookup_items(target));
+  }
+}
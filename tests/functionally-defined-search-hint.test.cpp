@@ -62,6 +62,15 @@ TEST_CASE("non-functionally defined not in search hint", "[rule]") {
     LZN_EXPECTED();
   }
 
+  SECTION("mutually recursive predicates") {
+    LZN_MODEL("var int: a;\n"
+              "var int: b;\n"
+              "predicate p(var int: x, var int: y) = x = y+1 /\\ q(y, x);\n"
+              "predicate q(var int: x, var int: y) = p(y, x);\n"
+              "constraint q(a, b);");
+    LZN_EXPECTED(LZN_ONELINE(1, 1, 10));
+  }
+
   SECTION("global_cardinality") {
     LZN_MODEL("array[1..5] of var int: xs;\n"
               "array[1..2] of int: to_count = [1,2];\n"
@@ -0,0 +1,128 @@
+#include "test_common.hpp"
+
+#include <limits>
+#include <linter/json.hpp>
+
+using LZN::Json;
+
+TEST_CASE("json parse", "[json]") {
+  SECTION("values") {
+    const auto v = Json::parse(" {\"a\": [1, -2.5, 3e2], \"b\": {\"c\": null}, \"d\": true} ");
+    REQUIRE(v);
+    const Json *a = v->get("a");
+    REQUIRE(a != nullptr);
+    REQUIRE(a->array() != nullptr);
+    REQUIRE(a->array()->size() == 3);
+    CHECK(*(*a->array())[0].number() == 1);
+    CHECK(*(*a->array())[1].number() == -2.5);
+    CHECK(*(*a->array())[2].number() == 300);
+    const Json *c = v->path({"b", "c"});
+    REQUIRE(c != nullptr);
+    CHECK(c->is_null());
+    REQUIRE(v->get("d") != nullptr);
+    CHECK(*v->get("d")->boolean());
+    CHECK(v->get("e") == nullptr);
+    CHECK(v->path({"a", "b"}) == nullptr);
+  }
+
+  SECTION("escapes") {
+    const auto v = Json::parse(R"("q\" b\\ s\/ \b\f\n\r\t")");
+    REQUIRE(v);
+    REQUIRE(v->string() != nullptr);
+    CHECK(*v->string() == "q\" b\\ s/ \b\f\n\r\t");
+  }
+
+  SECTION("unicode escapes") {
+    const auto v = Json::parse(R"("\u0041\u00e9\u20AC")");
+    REQUIRE(v);
+    CHECK(*v->string() == "A\xc3\xa9\xe2\x82\xac");
+  }
+
+  SECTION("surrogate pair") {
+    const auto v = Json::parse(R"("\ud83d\ude00")");
+    REQUIRE(v);
+    CHECK(*v->string() == "\xf0\x9f\x98\x80");
+  }
+
+  SECTION("malformed") {
+    const char *texts[] = {"",
+                           "   ",
+                           "tru",
+                           "nul",
+                           "-",
+                           "1 2",
+                           "[1,]",
+                           "[1 2]",
+                           "{\"a\":}",
+                           "{\"a\" 1}",
+                           "{a: 1}",
+                           "{\"a\": 1,}",
+                           "\"unterminated",
+                           R"("\x")",
+                           R"("\u12")",
+                           R"("\ud83d\u0041")",
+                           "[",
+                           "{"};
+    for (const char *text : texts) {
+      INFO(text);
+      CHECK(!Json::parse(text));
+    }
+  }
+
+  SECTION("depth limit") {
+    auto nested = [](std::size_t depth) {
+      return std::string(depth, '[') + std::string(depth, ']');
+    };
+    CHECK(Json::parse(nested(500)));
+    CHECK(!Json::parse(nested(600)));
+    CHECK(!Json::parse(nested(100000)));
+  }
+}
+
+TEST_CASE("json dump", "[json]") {
+  SECTION("compact text round trips") {
+    const char *texts[] = {"null",
+                           "true",
+                           "false",
+                           "0",
+                           "-12",
+                           "0.5",
+                           "\"\"",
+                           "[]",
+                           "{}",
+                           "[1,[2,[3]],{\"a\":\"b\"}]",
+                           "{\"b\":1,\"a\":2}"};
+    for (const char *text : texts) {
+      INFO(text);
+      const auto v = Json::parse(text);
+      REQUIRE(v);
+      CHECK(v->dump() == text);
+    }
+  }
+
+  SECTION("strings round trip") {
+    const std::string s = "q\" b\\ \n\r\t \x01\x1f \xc3\xa9";
+    const std::string dumped = Json(s).dump();
+    CHECK(dumped == "\"q\\\" b\\\\ \\n\\r\\t \\u0001\\u001f \xc3\xa9\"");
+    const auto v = Json::parse(dumped);
+    REQUIRE(v);
+    REQUIRE(v->string() != nullptr);
+    CHECK(*v->string() == s);
+  }
+
+  SECTION("values round trip") {
+    const Json v = Json::Object{{"id", 3},
+                                {"pi", 3.25},
+                                {"ok", true},
+                                {"none", nullptr},
+                                {"list", Json::Array{"x", 1u, Json::Object{}}}};
+    const auto parsed = Json::parse(v.dump());
+    REQUIRE(parsed);
+    CHECK(parsed->dump() == v.dump());
+    CHECK(*parsed->get("pi")->number() == 3.25);
+  }
+
+  SECTION("not finite numbers") {
+    CHECK(Json(std::numeric_limits<double>::infinity()).dump() == "null");
+  }
+}
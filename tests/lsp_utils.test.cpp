@@ -0,0 +1,62 @@
+#include "test_common.hpp"
+
+#include <linter/lsp_utils.hpp>
+
+namespace {
+using LZN::FileContents;
+
+// The `end` ("start" or "end") of `range` as line:character.
+std::string at(const LZN::Json &range, const char *end) {
+  const LZN::Json *line = range.path({end, "line"});
+  const LZN::Json *character = range.path({end, "character"});
+  REQUIRE(line != nullptr);
+  REQUIRE(character != nullptr);
+  return line->dump() + ':' + character->dump();
+}
+} // namespace
+
+TEST_CASE("lsp ranges", "[lsp]") {
+  SECTION("one line with an end") {
+    const auto range = LZN::lsp_range(FileContents(FileContents::OneLineMarked(3, 5, 9), "m"));
+    CHECK(at(range, "start") == "2:4");
+    CHECK(at(range, "end") == "2:9");
+  }
+
+  SECTION("one line to its end") {
+    const auto range = LZN::lsp_range(FileContents(FileContents::OneLineMarked(3, 5), "m"));
+    CHECK(at(range, "start") == "2:4");
+    CHECK(at(range, "end") == "3:0");
+  }
+
+  SECTION("one character") {
+    const auto range = LZN::lsp_range(FileContents(FileContents::OneLineMarked(1, 1, 1), "m"));
+    CHECK(at(range, "start") == "0:0");
+    CHECK(at(range, "end") == "0:1");
+  }
+
+  SECTION("several lines") {
+    const auto range = LZN::lsp_range(FileContents(FileContents::MultiLine(2, 4), "m"));
+    CHECK(at(range, "start") == "1:0");
+    CHECK(at(range, "end") == "4:0");
+  }
+
+  SECTION("nowhere") {
+    const auto range = LZN::lsp_range(FileContents());
+    CHECK(at(range, "start") == "0:0");
+    CHECK(at(range, "end") == "0:0");
+  }
+}
+
+TEST_CASE("lsp uris", "[lsp]") {
+  CHECK(LZN::uri_to_path("file:///home/me/model.mzn") == "/home/me/model.mzn");
+  CHECK(LZN::uri_to_path("file:///home/me/my%20model%2B1.mzn") == "/home/me/my model+1.mzn");
+  CHECK(LZN::uri_to_path("file:///%c3%a9.mzn") == "/\xc3\xa9.mzn");
+  // not percent-encoded bytes are kept as they are
+  CHECK(LZN::uri_to_path("file:///a%2") == "/a%2");
+  CHECK(LZN::uri_to_path("file:///a%zz") == "/a%zz");
+  CHECK(LZN::uri_to_path("untitled:Untitled-1") == "untitled:Untitled-1");
+
+  const std::string path = "/home/me/my model+1/\xc3\xa9.mzn";
+  CHECK(LZN::path_to_uri(path) == "file:///home/me/my%20model%2B1/%C3%A9.mzn");
+  CHECK(LZN::uri_to_path(LZN::path_to_uri(path)) == path);
+}
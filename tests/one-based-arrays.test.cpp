@@ -31,6 +31,37 @@ TEST_CASE("one based arrays", "[rule]") {
     LZN_EXPECTED();
   }
 
+  SECTION("okay array with unknown upper bound") {
+    LZN_MODEL("int: n;\n"
+              "array[1..n] of var int: xs;");
+    LZN_EXPECTED();
+  }
+
+  SECTION("okay array with unknown element") {
+    LZN_MODEL("int: n;\n"
+              "array[{1,n}] of var int: xs;");
+    LZN_EXPECTED();
+  }
+
+  SECTION("okay array with unknown upper bound in set") {
+    LZN_MODEL("int: n;\n"
+              "set of int: ns = 1..n;\n"
+              "array[ns] of var int: xs;");
+    LZN_EXPECTED();
+  }
+
+  SECTION("bad array with unknown lower bound") {
+    LZN_MODEL("1..5: m;\n"
+              "array[m..10] of var int: xs;");
+    LZN_EXPECTED(LZN_ONELINE(2, 7, 11));
+  }
+
+  SECTION("bad array with unknown set") {
+    LZN_MODEL("set of 1..5: S;\n"
+              "array[S] of var int: xs;");
+    LZN_EXPECTED(LZN_ONELINE(2, 7, 7));
+  }
+
   SECTION("bad array") {
     LZN_MODEL("array[2..5] of var int: xs;");
     LZN_EXPECTED(LZN_ONELINE(1, 7, 10));
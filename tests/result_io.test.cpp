@@ -0,0 +1,60 @@
+#include "test_common.hpp"
+
+#include <linter/result_io.hpp>
+
+namespace {
+using LZN::FileContents;
+using LZN::LintResult;
+
+void check_same(const FileContents &a, const FileContents &b) {
+  CHECK(a.filename == b.filename);
+  CHECK(a.region == b.region);
+}
+} // namespace
+
+TEST_CASE("results written and read back", "[result_io]") {
+  const LZN::LintRule *rule = *LZN::Registry::iter().begin();
+  std::vector<LintResult> results;
+  results.emplace_back(FileContents::OneLineMarked(3, 5, 9), "model.mzn", rule, "first");
+  results.emplace_back(FileContents::OneLineMarked(4, 2), "model.mzn", rule, "second");
+  auto &third = results.emplace_back(FileContents::MultiLine(1, 7), "other.mzn", rule, "third");
+  third.rewrite = "constraint x = 1;";
+  third.depends_on_instance = true;
+  third.emplace_subresult("is constrained here", FileContents::OneLineMarked(8, 1, 4),
+                          "data.dzn");
+  third.emplace_subresult("somewhere", FileContents::Region(), "");
+  results.emplace_back(FileContents::Region(), "", rule, "nowhere");
+
+  std::string bytes;
+  LZN::BinaryWriter w(bytes);
+  LZN::write_results(w, results);
+
+  SECTION("complete") {
+    LZN::BinaryReader r(bytes);
+    const auto read = LZN::read_results(r);
+    REQUIRE(read);
+    CHECK(r.at_end());
+    REQUIRE(read->size() == results.size());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      const auto &a = results[i];
+      const auto &b = (*read)[i];
+      CHECK(a.rule == b.rule);
+      CHECK(a.message == b.message);
+      check_same(a.content, b.content);
+      CHECK(a.rewrite == b.rewrite);
+      CHECK(a.depends_on_instance == b.depends_on_instance);
+      REQUIRE(a.sub_results.size() == b.sub_results.size());
+      for (std::size_t j = 0; j < a.sub_results.size(); ++j) {
+        CHECK(a.sub_results[j].message == b.sub_results[j].message);
+        check_same(a.sub_results[j].content, b.sub_results[j].content);
+      }
+    }
+  }
+
+  SECTION("truncated") {
+    const std::string truncated = bytes.substr(0, bytes.size() - 1);
+    LZN::BinaryReader r(truncated);
+    CHECK(!LZN::read_results(r));
+    CHECK(!r.ok());
+  }
+}
@@ -1,5 +1,8 @@
+#include <algorithm>
 #include <catch2/catch.hpp>
+#include <cstring>
 #include <linter/searcher.hpp>
+#include <linter/utils.hpp>
 #include <minizinc/ast.hh>
 #include <minizinc/gc.hh>
 #include <minizinc/parser.hh>
@@ -203,6 +206,24 @@ TEST_CASE("ExprSearcher big tree", "[util]") {
   }
 }
 
+TEST_CASE("model searcher visits every kind of child", "[util]") {
+  MiniZinc::Model *m = parse("constraint let {\n"
+                             "  array[S] of var T: a;\n"
+                             "  constraint a[1] = -a[2] :: ann(4);\n"
+                             "} in forall(i in [1, 2, 3], j in {i + 5} where i > j)(\n"
+                             "  if i = 1 then a[j] = 1\n"
+                             "  elseif i = 2 then a[j] = 2\n"
+                             "  else true endif);");
+  const auto s = SearchBuilder().in_constraint().under(ExpressionId::E_INTLIT).capture().build();
+  auto ms = s.search(m);
+  std::vector<long long> ints;
+  while (ms.next()) {
+    ints.push_back(ms.capture_cast<IntLit>(0)->v().toInt());
+  }
+  std::sort(ints.begin(), ints.end());
+  CHECK(ints == std::vector<long long>{1, 1, 1, 1, 2, 2, 2, 2, 3, 4, 5});
+}
+
 TEST_CASE("model searcher items only", "[util]") {
   MiniZinc::Model *m = parse("var int: x;"
                              "constraint 1+2+3+4+5 = x;"
@@ -243,6 +264,54 @@ TEST_CASE("model searcher with ExprSearcher", "[util]") {
   CHECK(ms.cur_item() == nullptr);
 }
 
+TEST_CASE("expression searcher over several roots", "[util]") {
+  MiniZinc::GCLock lock;
+  Expression *one = IntLit::a(IntVal(1));
+  Expression *two = IntLit::a(IntVal(2));
+  Expression *plus = new BinOp(nowhere, one, BinOpType::BOT_PLUS, two);
+  Expression *minus = new UnOp(nowhere, UnOpType::UOT_MINUS, two);
+  const std::vector<const Expression *> roots = {plus, one, minus, two};
+  const Search s = SearchBuilder().under(ExpressionId::E_INTLIT).capture().build();
+
+  SECTION("reset") {
+    auto es = s.search(plus);
+    CHECK(number_of_results(es) == 2);
+    es.reset(minus);
+    REQUIRE(es.next());
+    CHECK(es.capture(0) == two);
+    CHECK(!es.next());
+  }
+
+  SECTION("range") {
+    auto es = s.search(roots.begin(), roots.end());
+    std::vector<const Expression *> hit_roots;
+    std::vector<std::pair<const Expression *, const Expression *>> hits;
+    while (es.next()) {
+      hit_roots.push_back(es.root());
+      hits.emplace_back(es.root(), es.capture(0));
+    }
+    CHECK(hit_roots == std::vector<const Expression *>{plus, plus, one, minus, two});
+    decltype(hits) expected = {{plus, one}, {plus, two}, {one, one}, {minus, two}, {two, two}};
+    std::sort(hits.begin(), hits.end());
+    std::sort(expected.begin(), expected.end());
+    CHECK(hits == expected);
+  }
+
+  SECTION("skip root") {
+    auto es = s.search(roots.begin(), roots.end());
+    REQUIRE(es.next());
+    CHECK(es.root() == plus);
+    es.skip_root();
+    REQUIRE(es.next());
+    CHECK(es.root() == one);
+  }
+
+  SECTION("empty range") {
+    auto es = s.search(roots.end(), roots.end());
+    CHECK(!es.next());
+  }
+}
+
 TEST_CASE("model searcher empty builder", "[util]") {
   MiniZinc::Model *m = parse("constraint 1+2+3+4+5 = x;");
   Search s = SearchBuilder().build();
@@ -319,3 +388,456 @@ TEST_CASE("model searcher local filters", "[util]") {
   }
   CHECK(results == 2);
 }
+
+namespace {
+template <typename T>
+std::vector<std::vector<const Expression *>> sorted_captures(T &searcher, std::size_t numcaptures) {
+  std::vector<std::vector<const Expression *>> captures;
+  while (searcher.next()) {
+    auto &caps = captures.emplace_back();
+    for (std::size_t i = 0; i < numcaptures; ++i) {
+      caps.push_back(searcher.capture(i));
+    }
+  }
+  std::sort(captures.begin(), captures.end());
+  return captures;
+}
+} // namespace
+
+TEST_CASE("model searcher call identifiers", "[util]") {
+  MiniZinc::Model *m = parse("var int: x;\n"
+                             "constraint sum([bool2int(x = i) | i in 1..3]) = 1 /\\ abs(x) > 0;");
+
+  auto count = [m](SearchBuilder &sb) {
+    const Search s = sb.in_constraint().capture().build();
+    auto ms = s.search(m);
+    return number_of_results(ms);
+  };
+  using MiniZinc::ASTString;
+  CHECK(count(SearchBuilder().under(ExpressionId::E_CALL)) == 3);
+  CHECK(count(SearchBuilder().under(ASTString("sum"))) == 1);
+  CHECK(count(SearchBuilder().under(ASTString("max"))) == 0);
+  CHECK(count(SearchBuilder().under({ASTString("abs"), ASTString("sum")})) == 2);
+  CHECK(count(SearchBuilder().under(ASTString("sum")).under(ASTString("bool2int"))) == 1);
+  CHECK(count(SearchBuilder().under(ASTString("bool2int")).under(ASTString("sum"))) == 0);
+  CHECK(count(SearchBuilder().under(ASTString("sum")).direct(ASTString("bool2int"))) == 0);
+
+  CHECK(SearchBuilder().under(ASTString("sum")).build() ==
+        SearchBuilder().under(ASTString("sum")).build());
+  CHECK(SearchBuilder().under(ASTString("sum")).build() !=
+        SearchBuilder().under(ASTString("abs")).build());
+  CHECK(SearchBuilder().under(ASTString("sum")).build() !=
+        SearchBuilder().under(ExpressionId::E_CALL).build());
+}
+
+TEST_CASE("multi search same as model searcher", "[util]") {
+  MiniZinc::Model *m = parse("var int: x;\n"
+                             "var int: y;\n"
+                             "constraint A :: X = B + C;\n"
+                             "constraint forall(i in 1..3)(x = i -> y = i);\n"
+                             "constraint x = 1 /\\ (y = 2 -> x = 2);\n"
+                             "function var int: f(var int: a) = a + x + 1;\n"
+                             "solve satisfy;");
+
+  const std::vector<Search> searches = {
+      SearchBuilder().in_everywhere().under(ExpressionId::E_ID).capture().build(),
+      SearchBuilder()
+          .global_filter(LZN::filter_out_annotations)
+          .in_everywhere()
+          .under(ExpressionId::E_ID)
+          .capture()
+          .build(),
+      SearchBuilder()
+          .in_constraint()
+          .under(BinOpType::BOT_EQ)
+          .capture()
+          .under(ExpressionId::E_ID)
+          .capture()
+          .build(),
+      SearchBuilder()
+          .in_constraint()
+          .under(BinOpType::BOT_IMPL)
+          .capture()
+          .filter([](const Expression *root, const Expression *child) {
+            return root->cast<MiniZinc::BinOp>()->lhs() == child;
+          })
+          .direct(BinOpType::BOT_EQ)
+          .capture()
+          .direct(ExpressionId::E_ID)
+          .capture()
+          .build(),
+      SearchBuilder().in_function_body().under(BinOpType::BOT_PLUS).capture().build(),
+      SearchBuilder().in_function_params().under(ExpressionId::E_TI).build(),
+      SearchBuilder().in_constraint().in_solve().build(),
+  };
+
+  LZN::MultiSearch multi;
+  for (const auto &s : searches) {
+    multi.add(s);
+  }
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  auto hits = multi.search(tree);
+  REQUIRE(hits.size() == searches.size());
+
+  for (std::size_t i = 0; i < searches.size(); ++i) {
+    const std::size_t numcaptures = hits[i].num_captures();
+    auto ms = searches[i].search(m);
+    Search::HitsSearcher hs(hits[i]);
+    CHECK(sorted_captures(ms, numcaptures) == sorted_captures(hs, numcaptures));
+  }
+}
+
+TEST_CASE("parallel multi search same as multi search", "[util]") {
+  std::string model = "var int: x;\nvar int: y;\nsolve satisfy;\n";
+  for (int i = 0; i < 50; ++i) {
+    model += "constraint x + " + std::to_string(i) + " = y \\/ y = " + std::to_string(i) + ";\n";
+  }
+  MiniZinc::Model *m = parse(model.c_str());
+
+  const std::vector<Search> searches = {
+      SearchBuilder().in_everywhere().under(ExpressionId::E_ID).capture().build(),
+      SearchBuilder()
+          .in_constraint()
+          .under(BinOpType::BOT_EQ)
+          .capture()
+          .direct(BinOpType::BOT_PLUS)
+          .capture()
+          .build(),
+      SearchBuilder().in_constraint().in_solve().build(),
+  };
+  LZN::MultiSearch multi;
+  for (const auto &s : searches) {
+    multi.add(s);
+  }
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  const auto expected = multi.search(tree);
+
+  for (unsigned int jobs : {1, 2, 3, 16}) {
+    const auto hits = multi.search_parallel(tree, jobs);
+    REQUIRE(hits.size() == expected.size());
+    for (std::size_t i = 0; i < hits.size(); ++i) {
+      REQUIRE(hits[i].size() == expected[i].size());
+      for (std::size_t h = 0; h < hits[i].size(); ++h) {
+        CHECK(hits[i].item(h) == expected[i].item(h));
+        for (std::size_t c = 0; c < hits[i].num_captures(); ++c) {
+          CHECK(hits[i].capture(h, c) == expected[i].capture(h, c));
+        }
+        auto [hb, he] = hits[i].path(h);
+        auto [eb, ee] = expected[i].path(h);
+        CHECK(std::vector<const Expression *>(hb, he) == std::vector<const Expression *>(eb, ee));
+      }
+    }
+  }
+}
+
+TEST_CASE("multi search path", "[util]") {
+  MiniZinc::Model *m = parse("constraint true /\\ x = 1;");
+  Search s = SearchBuilder()
+                 .in_constraint()
+                 .under(BinOpType::BOT_EQ)
+                 .capture()
+                 .direct(ExpressionId::E_ID)
+                 .capture()
+                 .build();
+  LZN::MultiSearch multi;
+  multi.add(s);
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  auto hits = multi.search(tree);
+  Search::HitsSearcher hs(hits.front());
+  auto ms = s.search(m);
+
+  REQUIRE(ms.next());
+  REQUIRE(hs.next());
+  auto [mb, me] = ms.current_path();
+  auto [hb, he] = hs.current_path();
+  CHECK(std::vector<const Expression *>(mb, me) == std::vector<const Expression *>(hb, he));
+  CHECK(std::distance(hb, he) == 3);
+  CHECK(*hb == hs.capture(1));
+  CHECK(!ms.next());
+  CHECK(!hs.next());
+}
+
+TEST_CASE("hits searcher skip item", "[util]") {
+  MiniZinc::Model *m = parse("constraint 1 + 2 = 3;\n"
+                             "constraint 4 + 5 = 6;");
+  Search s = SearchBuilder().in_constraint().under(ExpressionId::E_INTLIT).capture().build();
+  LZN::MultiSearch multi;
+  multi.add(s);
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  auto hits = multi.search(tree);
+  REQUIRE(hits.front().size() == 6);
+
+  Search::HitsSearcher hs(hits.front());
+  CHECK(hs.cur_item() == nullptr);
+  REQUIRE(hs.next());
+  const MiniZinc::Item *first = hs.cur_item();
+  CHECK(first != nullptr);
+  hs.skip_item();
+  REQUIRE(hs.next());
+  CHECK(hs.cur_item() != first);
+  CHECK(number_of_results(hs) == 2);
+  CHECK(hs.cur_item() == nullptr);
+}
+
+TEST_CASE("node index same as model searcher", "[util]") {
+  MiniZinc::Model *m = parse("var int: x;\n"
+                             "var int: y = x + 1;\n"
+                             "constraint x + 1 = y /\\ not (x = 2);\n"
+                             "constraint forall(i in 1..3)(x != i -> y = i);\n"
+                             "function var int: f(var int: a) = let {var int: b = a} in b + x;\n"
+                             "solve :: int_search([x], input_order, indomain_min) minimize x;\n"
+                             "output [show(x)];");
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  const LZN::NodeIndex index(tree);
+
+  const std::vector<Search> searches = {
+      SearchBuilder().in_everywhere().under(ExpressionId::E_ID).capture().build(),
+      SearchBuilder().in_everywhere().under(ExpressionId::E_BINOP).capture().build(),
+      SearchBuilder().in_everywhere().under(BinOpType::BOT_PLUS).capture().build(),
+      SearchBuilder().in_everywhere().under(UnOpType::UOT_NOT).capture().build(),
+      SearchBuilder().in_constraint().under(ExpressionId::E_INTLIT).capture().build(),
+      SearchBuilder().in_function_body().in_vardecl().under(ExpressionId::E_VARDECL).build(),
+      SearchBuilder().in_function_params().under(ExpressionId::E_VARDECL).capture().build(),
+      SearchBuilder().in_solve().in_output().under(ExpressionId::E_CALL).capture().build(),
+      SearchBuilder().in_everywhere().under(MiniZinc::ASTString("forall")).capture().build(),
+  };
+
+  for (const auto &s : searches) {
+    REQUIRE(index.can_answer(s));
+    const auto hits = index.hits(s);
+    const std::size_t numcaptures = hits.num_captures();
+    auto ms = s.search(m);
+    Search::HitsSearcher hs(hits);
+    CHECK(sorted_captures(ms, numcaptures) == sorted_captures(hs, numcaptures));
+  }
+
+  // the paths are the same as well
+  const Search plus = SearchBuilder().in_constraint().under(BinOpType::BOT_PLUS).build();
+  auto ms = plus.search(m);
+  const auto hits = index.hits(plus);
+  Search::HitsSearcher hs(hits);
+  REQUIRE(ms.next());
+  REQUIRE(hs.next());
+  auto [mb, me] = ms.current_path();
+  auto [hb, he] = hs.current_path();
+  CHECK(std::vector<const Expression *>(mb, me) == std::vector<const Expression *>(hb, he));
+  CHECK(!ms.next());
+  CHECK(!hs.next());
+}
+
+TEST_CASE("node index only answers single node searches", "[util]") {
+  MiniZinc::Model *m = parse("constraint 1 + 2 = 3;");
+  const std::vector<std::string> includePath;
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  const LZN::NodeIndex index(tree);
+
+  CHECK(index.can_answer(SearchBuilder().in_constraint().under(ExpressionId::E_INTLIT).build()));
+  CHECK(!index.can_answer(SearchBuilder().in_constraint().direct(ExpressionId::E_INTLIT).build()));
+  CHECK(!index.can_answer(SearchBuilder()
+                              .in_constraint()
+                              .under(ExpressionId::E_BINOP)
+                              .under(ExpressionId::E_INTLIT)
+                              .build()));
+  CHECK(!index.can_answer(SearchBuilder()
+                              .global_filter(LZN::filter_out_annotations)
+                              .in_constraint()
+                              .under(ExpressionId::E_INTLIT)
+                              .build()));
+  CHECK(!index.can_answer(
+      SearchBuilder().in_constraint().recursive().under(ExpressionId::E_INTLIT).build()));
+  CHECK(!index.can_answer(SearchBuilder()
+                              .only_user_defined(includePath)
+                              .in_constraint()
+                              .under(ExpressionId::E_INTLIT)
+                              .build()));
+}
+
+TEST_CASE("flat tree", "[util]") {
+  MiniZinc::Model *m = parse("constraint 1 + 2 = -x;");
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  using LZN::FlatTree;
+
+  REQUIRE(tree.num_items() == 1);
+  CHECK(tree.item_roots(0) == std::make_pair<std::size_t, std::size_t>(0, 1));
+  REQUIRE(tree.size() == 6);
+  const std::size_t root = tree.root_node(0);
+  CHECK(root == 0);
+  CHECK(tree.parent(root) == FlatTree::NONE);
+  CHECK(tree.end(root) == tree.size());
+  CHECK(tree.depth(root) == 0);
+  CHECK(tree.item_of(root) == tree.item(0));
+
+  for (std::size_t i = 1; i < tree.size(); ++i) {
+    const std::size_t parent = tree.parent(i);
+    CHECK(tree.is_ancestor(parent, i));
+    CHECK(!tree.is_ancestor(i, parent));
+    CHECK(tree.depth(i) == tree.depth(parent) + 1);
+    CHECK(tree.end(i) <= tree.end(parent));
+    CHECK(tree.index_of(tree.expr(i)) == i);
+  }
+
+  const auto eq = tree.expr(root)->cast<BinOp>();
+  std::vector<const Expression *> children;
+  tree.for_each_child(root, [&](std::size_t c) { children.push_back(tree.expr(c)); });
+  std::sort(children.begin(), children.end());
+  std::vector<const Expression *> sides{eq->lhs(), eq->rhs()};
+  std::sort(sides.begin(), sides.end());
+  CHECK(children == sides);
+
+  const std::size_t one = tree.index_of(eq->lhs()->cast<BinOp>()->lhs());
+  REQUIRE(one != FlatTree::NONE);
+  auto [pb, pe] = tree.path(one, root);
+  CHECK(std::vector<const Expression *>(pb, pe) ==
+        std::vector<const Expression *>{tree.expr(one), eq->lhs(), eq});
+  CHECK(tree.index_of(nullptr) == FlatTree::NONE);
+
+  using LZN::Impl::kind_bit;
+  const std::size_t plus = tree.index_of(eq->lhs());
+  CHECK(tree.subtree_kinds(one) == kind_bit(ExpressionId::E_INTLIT));
+  CHECK(tree.subtree_kinds(plus) ==
+        (kind_bit(ExpressionId::E_BINOP) | kind_bit(BinOpType::BOT_PLUS) |
+         kind_bit(ExpressionId::E_INTLIT)));
+  CHECK(tree.may_contain(root, kind_bit(UnOpType::UOT_MINUS) | kind_bit(ExpressionId::E_ID) |
+                                   kind_bit(BinOpType::BOT_EQ) | tree.subtree_kinds(plus)));
+  CHECK(!tree.may_contain(plus, kind_bit(ExpressionId::E_ID)));
+  CHECK(!tree.may_contain(root, kind_bit(BinOpType::BOT_IMPL)));
+}
+
+TEST_CASE("flat equal constrained variables", "[util]") {
+  MiniZinc::Model *m = parse("constraint x = 1 /\\ (y = 2 -> x = 2) /\\ forall(i in S)(z = i);");
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  const Expression *con = tree.expr(tree.root_node(0));
+
+  using Found = std::vector<std::pair<const Expression *, const Expression *>>;
+  Found expr_found, flat_found;
+  const LZN::FlatTree own(con);
+  LZN::equal_constrained_variables(own, 0, [&](const BinOp *eq, const MiniZinc::Id *id) {
+    expr_found.emplace_back(eq, id);
+  });
+  LZN::equal_constrained_variables(tree, 0, [&](const BinOp *eq, const MiniZinc::Id *id) {
+    flat_found.emplace_back(eq, id);
+  });
+  std::sort(expr_found.begin(), expr_found.end());
+  std::sort(flat_found.begin(), flat_found.end());
+  CHECK(expr_found.size() == 3);
+  CHECK(expr_found == flat_found);
+}
+
+TEST_CASE("flat tree context", "[util]") {
+  MiniZinc::Model *m =
+      parse("constraint x = 1 /\\ (not (y = 2) \\/ z) /\\ forall(i in S)(not (w = i));");
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+  using LZN::FlatTree;
+  using Context = FlatTree::Context;
+
+  for (std::size_t node = 0; node < tree.size(); ++node) {
+    for (std::size_t top = node; top != FlatTree::NONE; top = tree.parent(top)) {
+      auto [pb, pe] = tree.path(node, top);
+      const std::vector<const Expression *> path(pb, pe);
+      CHECK(tree.is_conjunctive(node, top) == LZN::is_conjunctive(path.begin(), path.end()));
+    }
+  }
+
+  auto id_node = [&tree](const char *name) {
+    for (std::size_t node = 0; node < tree.size(); ++node) {
+      auto id = tree.expr(node)->dynamicCast<MiniZinc::Id>();
+      if (id != nullptr && strcmp(id->v().c_str(), name) == 0)
+        return node;
+    }
+    return FlatTree::NONE;
+  };
+  const std::size_t x = id_node("x"), y = id_node("y"), z = id_node("z"), w = id_node("w");
+  REQUIRE(x != FlatTree::NONE);
+  REQUIRE(y != FlatTree::NONE);
+  REQUIRE(z != FlatTree::NONE);
+  REQUIRE(w != FlatTree::NONE);
+  const std::size_t root = tree.root_node(0);
+  const std::size_t w_eq = tree.parent(w);
+
+  CHECK(tree.context(tree.parent(x), root) == Context::conjunctive);
+  CHECK(tree.context(tree.parent(y), root) == Context::negated);
+  CHECK(tree.context(z, root) == Context::reified);
+  CHECK(tree.context(tree.parent(w_eq), root) == Context::conjunctive);
+  CHECK(tree.context(w_eq, root) == Context::negated);
+  CHECK(tree.context(w_eq, tree.parent(w_eq)) == Context::negated);
+  CHECK(tree.context(root, root) == Context::conjunctive);
+
+  CHECK(!tree.in_forall_body(x, root));
+  CHECK(tree.in_forall_body(w_eq, root));
+  CHECK(tree.in_forall_body(w, root));
+  CHECK(!tree.in_forall_body(w, tree.parent(w_eq)));
+}
+
+TEST_CASE("pattern same as search", "[util]") {
+  MiniZinc::Model *m = parse("constraint a[1] = 2 /\\ forall(i in S)(a[i] = b[i] :: X);\n"
+                             "constraint x = y + (z = 2);");
+  const LZN::FlatTree tree(m, SearchBuilder().build());
+
+  auto search_hits = [&m](const Search &s) {
+    std::vector<std::vector<const Expression *>> res;
+    auto ms = s.search(m);
+    while (ms.next()) {
+      auto &caps = res.emplace_back();
+      auto [pb, pe] = ms.current_path();
+      caps.insert(caps.end(), pb, pe);
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+  };
+  auto pattern_hits = [&tree](auto pattern) {
+    using P = decltype(pattern);
+    std::vector<std::vector<const Expression *>> res;
+    for (std::size_t r = 0; r < 2; ++r) {
+      P::search(tree, tree.root_node(r),
+                [&res](const typename P::Hit &, LZN::FlatTree::PathIters path) {
+                  res.emplace_back(path.first, path.second);
+                });
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+  };
+
+  SECTION("under direct") {
+    using P = LZN::Pattern<LZN::Under<BinOpType::BOT_EQ, LZN::Capture>,
+                           LZN::Direct<ExpressionId::E_ID, LZN::Capture>>;
+    static_assert(std::is_same_v<P::Hit, std::tuple<const BinOp *, const MiniZinc::Id *>>);
+    const auto s = SearchBuilder()
+                       .in_constraint()
+                       .under(BinOpType::BOT_EQ)
+                       .capture()
+                       .direct(ExpressionId::E_ID)
+                       .capture()
+                       .build();
+    CHECK(pattern_hits(P()) == search_hits(s));
+    CHECK(search_hits(s).size() == 2);
+  }
+
+  SECTION("filters") {
+    using P = LZN::Pattern<LZN::GlobalFilters<LZN::filter_out_annotations>,
+                           LZN::Under<ExpressionId::E_ARRAYACCESS, LZN::Capture,
+                                      LZN::Filter<LZN::filter_arrayaccess_idx>>,
+                           LZN::Under<ExpressionId::E_ID>>;
+    static_assert(std::is_same_v<P::Hit, std::tuple<const MiniZinc::ArrayAccess *>>);
+    const auto s = SearchBuilder()
+                       .global_filter(LZN::filter_out_annotations)
+                       .in_constraint()
+                       .under(ExpressionId::E_ARRAYACCESS)
+                       .capture()
+                       .filter(LZN::filter_arrayaccess_idx)
+                       .under(ExpressionId::E_ID)
+                       .build();
+    CHECK(pattern_hits(P()) == search_hits(s));
+    CHECK(search_hits(s).size() == 2);
+  }
+
+  SECTION("direct root") {
+    using P = LZN::Pattern<LZN::Direct<BinOpType::BOT_EQ>, LZN::Under<BinOpType::BOT_EQ>>;
+    const auto s = SearchBuilder()
+                       .in_constraint()
+                       .direct(BinOpType::BOT_EQ)
+                       .under(BinOpType::BOT_EQ)
+                       .build();
+    CHECK(pattern_hits(P()) == search_hits(s));
+    CHECK(search_hits(s).size() == 1);
+  }
+}
@@ -55,6 +55,8 @@ inline constexpr const char *const MODEL_FILENAME = "testmodel";
 
 #define LZN_MODEL(s)                                                                               \
   LZN_ONLY_PARSE(s);                                                                               \
+  rule->prepare(lenv);                                                                             \
+  lenv.perform_requested_searches();                                                               \
   rule->run(lenv);                                                                                 \
   results = lenv.take_results();
 